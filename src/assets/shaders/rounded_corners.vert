@@ -2,14 +2,23 @@
 
 precision mediump float;
 
-attribute vec2 aPos;
+attribute vec2 aPos;          // framebuffer position(logical px)
 attribute vec2 aTexCoord;
+attribute vec2 aLocal;        // position relative to the window centre(physical px)
+attribute vec4 aShape;        // xy: window half size, z: radius, w: border width(physical px)
+attribute vec3 aBorderColor;
 
 uniform mat4 u_transform;
 
 varying vec2 v_texcoord;
+varying vec2 v_local;
+varying vec4 v_shape;
+varying vec3 v_border_color;
 
 void main() {
     gl_Position = u_transform * vec4(aPos, 0.0, 1.0);
     v_texcoord = aTexCoord;
-}
\ No newline at end of file
+    v_local = aLocal;
+    v_shape = aShape;
+    v_border_color = aBorderColor;
+}
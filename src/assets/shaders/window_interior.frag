@@ -0,0 +1,13 @@
+#version 100
+// Tiley compositor: window_interior.frag
+// feature: inner part of a rounded corner window, away from corners and border
+// Shares rounded_corners.vert, only position and texture coordinates are used
+
+precision mediump float;
+varying vec2 v_texcoord;
+
+uniform sampler2D u_texture;      // Window content texture
+
+void main() {
+    gl_FragColor = texture2D(u_texture, v_texcoord);
+}
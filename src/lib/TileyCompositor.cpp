@@ -2,11 +2,14 @@
 #include "LCompositor.h"
 #include "LNamespaces.h"
 #include "TileyServer.hpp"
+#include "TileyWindowStateManager.hpp"
 #include "src/lib/client/Client.hpp"
 #include "src/lib/client/ToplevelRole.hpp"
 #include "src/lib/input/Keyboard.hpp"
 #include "src/lib/input/Pointer.hpp"
+#include "src/lib/input/SurfaceIndex.hpp"
 #include "src/lib/input/Seat.hpp"
+#include "src/lib/ipc/IPCManager.hpp"
 #include "src/lib/output/Output.hpp"
 #include "src/lib/surface/Surface.hpp"
 
@@ -90,6 +93,7 @@ void TileyCompositor::initialized(){
         // tell the monitor to unlock its rendering thread
         output->repaint();
     }
+    SurfaceIndex::invalidateAll();
 
     // TODO: enable waybar when config requires
     // TODO: launch waybar with args
@@ -106,7 +110,10 @@ void TileyCompositor::initialized(){
 }
 
 void TileyCompositor::uninitialized(){
+    // the event loop still runs, subscribers get the event before the socket goes away
+    IPCManager::getInstance().broadcastShutdown();
     // Destroy all environmental objects here
+    TileyWindowStateManager::getInstance().shutdown();
 }
 
 
@@ -6,6 +6,7 @@
 
 #include "src/lib/TileyServer.hpp"
 #include "src/lib/input/ShortcutManager.hpp"
+#include "src/lib/output/Output.hpp"
 #include "src/lib/scene/Scene.hpp"
 #include "TileyCompositor.hpp"
 #include "Utils.hpp"
@@ -37,80 +38,89 @@ void TileyServer::populateStartupCMD(std::string cmd){
     startUpCMD.push_back(cmd);   
 }
 
-void TileyServer::initOpenGLResources(){
+// linkProgram: compile `vertName` and `fragName` of the shader directory and link them into `shader`
+static bool linkProgram(Shader& shader, const char* vertName, const char* fragName){
 
-    std::string vert_path = getShaderPath("rounded_corners.vert");
-    std::string frag_path = getShaderPath("rounded_corners.frag");
+    std::string vert_path = getShaderPath(vertName);
+    std::string frag_path = getShaderPath(fragName);
 
-    if (!vert_path.empty() && !frag_path.empty()) {
+    if (vert_path.empty() || frag_path.empty()) {
+        LLog::error("[linkProgram]: unable to find %s or %s", vertName, fragName);
+        return false;
+    }
 
-        char* vShaderSrc = LOpenGL::openShader(vert_path.c_str());
-        char* fShaderSrc = LOpenGL::openShader(frag_path.c_str());
+    char* vShaderSrc = LOpenGL::openShader(vert_path.c_str());
+    char* fShaderSrc = LOpenGL::openShader(frag_path.c_str());
 
-        if (!vShaderSrc || !fShaderSrc) {
-            LLog::error("[initOpenGLResources]: unable to open shader path, please check. Stop compiling");
-            if(vShaderSrc) free(vShaderSrc);
-            if(fShaderSrc) free(fShaderSrc);
-            return;
-        }
+    if (!vShaderSrc || !fShaderSrc) {
+        LLog::error("[linkProgram]: unable to open shader path, please check. Stop compiling");
+        if(vShaderSrc) free(vShaderSrc);
+        if(fShaderSrc) free(fShaderSrc);
+        return false;
+    }
 
-        GLuint vShader = LOpenGL::compileShader(GL_VERTEX_SHADER, vShaderSrc);
-        GLuint fShader = LOpenGL::compileShader(GL_FRAGMENT_SHADER, fShaderSrc);
+    GLuint vShader = LOpenGL::compileShader(GL_VERTEX_SHADER, vShaderSrc);
+    GLuint fShader = LOpenGL::compileShader(GL_FRAGMENT_SHADER, fShaderSrc);
 
-        free(vShaderSrc);
-        free(fShaderSrc);
+    free(vShaderSrc);
+    free(fShaderSrc);
 
-        if (vShader == 0 || fShader == 0) {
-            LLog::error("[initOpenGLResources]: unable to compile shaders, see output for details");
-            return;
-        }
-        
-        m_roundedCornerShader = std::make_unique<Shader>();
-        if (!m_roundedCornerShader->link(vShader, fShader)) {
-            LLog::error("[initOpenGLResources]: unable to link shaders, this may be a bug, please report");
-            m_roundedCornerShader.reset();
-        }
+    if (vShader == 0 || fShader == 0) {
+        LLog::error("[linkProgram]: unable to compile %s/%s, see output for details", vertName, fragName);
+        if(vShader) glDeleteShader(vShader);
+        if(fShader) glDeleteShader(fShader);
+        return false;
+    }
+
+    bool linked = shader.link(vShader, fShader);
+    if (!linked) {
+        LLog::error("[linkProgram]: unable to link %s/%s, this may be a bug, please report", vertName, fragName);
+    }
 
-        glDeleteShader(vShader);
-        glDeleteShader(fShader);
-
-        // EBO & VBO
-        // start from bottom-right and rotating clockwise
-        float vertices[] = {
-            // pos      // tex
-            1.f, 1.f,   1.f, 1.f,
-            0.f, 1.f,   0.f, 1.f,
-            0.f, 0.f,   0.f, 0.f,
-            1.f, 0.f,   1.f, 0.f 
-        };
-
-        unsigned int indices[] = {
-            0, 1, 2,
-            2, 3, 0
-        };
-        
-        glGenBuffers(1, &m_quadVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, m_quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glGenBuffers(1, &m_quadEBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_quadEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    } else {
+    glDeleteShader(vShader);
+    glDeleteShader(fShader);
+
+    return linked;
+}
 
+void TileyServer::initOpenGLResources(){
+
+    m_roundedCornerShader = std::make_unique<RoundedCornerShader>();
+    if (!linkProgram(*m_roundedCornerShader, "rounded_corners.vert", "rounded_corners.frag")) {
         LLog::warning("[initOpenGLResources]: warning: unable to use custom shaders, fallback to default pipeline");
-        
+        m_roundedCornerShader.reset();
+        return;
+    }
+
+    m_windowInteriorShader = std::make_unique<WindowInteriorShader>();
+    // a program with an inactive attribute could not be fed, see `WindowInteriorShader::valid`
+    if (!linkProgram(*m_windowInteriorShader, "rounded_corners.vert", "window_interior.frag") || !m_windowInteriorShader->valid()) {
+        LLog::warning("[initOpenGLResources]: warning: window interiors will be drawn by the rounded corner shader");
+        m_windowInteriorShader.reset();
     }
 }
 
 void TileyServer::uninitOpenGLResources(){
     m_roundedCornerShader.reset();
-    glDeleteBuffers(1, &m_quadVBO);
-    glDeleteBuffers(1, &m_quadEBO);
+    m_windowInteriorShader.reset();
+    // offscreen rendering of the main thread(e.g. thumbnails) has no output
+    releaseRenderState(nullptr);
+}
+
+TileyServer::OutputRenderResources& TileyServer::renderResources(LOutput* output){
+    if (output) {
+        if (OutputRenderResources* resources = static_cast<Output*>(output)->renderResources()) {
+            return *resources;
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_renderStatesMutex);
+    // references stay valid on rehash, only `releaseRenderState` removes elements
+    return m_renderStates[output];
+}
+
+void TileyServer::releaseRenderState(const LOutput* output){
+    std::lock_guard<std::mutex> lock(m_renderStatesMutex);
+    m_renderStates.erase(output);
 }
 
 void TileyServer::initKeyEventHandlers(){
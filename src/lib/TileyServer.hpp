@@ -3,11 +3,16 @@
 #include "src/lib/input/Seat.hpp"
 #include "src/lib/client/views/LayerView.hpp"
 #include "src/lib/scene/Scene.hpp"
-#include "src/lib/client/render/Shader.hpp"
+#include "src/lib/client/render/RoundedCornerShader.hpp"
+#include "src/lib/client/render/WindowInteriorShader.hpp"
+#include "src/lib/client/render/GLRenderState.hpp"
+#include "src/lib/client/render/DecorationRenderer.hpp"
+#include "src/lib/output/DamageAccumulator.hpp"
 
 #include <GLES2/gl2.h>
 #include <LOutput.h>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "TileyCompositor.hpp"
@@ -29,6 +34,9 @@ namespace tiley{
 
             LayerView* layers() noexcept;
 
+            // damage: record areas changed by tiley, only outputs showing them are repainted
+            inline DamageAccumulator& damage() noexcept { return m_damage; }
+
             static TileyServer& getInstance();
 
             // temp
@@ -39,10 +47,22 @@ namespace tiley{
 
             // TODO: manage shader scripts in one place
             // Window round corner shader
-            inline Shader* roundedCornerShader() const { return m_roundedCornerShader.get(); }
-
-            GLuint quadVBO() const { return m_quadVBO; }
-            GLuint quadEBO() const { return m_quadEBO; }
+            inline RoundedCornerShader* roundedCornerShader() const { return m_roundedCornerShader.get(); }
+            // Plain shader for window interiors, nullptr if unavailable
+            inline WindowInteriorShader* windowInteriorShader() const { return m_windowInteriorShader.get(); }
+
+            // every output renders in its own thread with its own context
+            struct OutputRenderResources {
+                // GL state shadow of the context, custom draws should change GL state through it
+                GLRenderState state;
+                // rounded corner windows waiting to be drawn
+                DecorationRenderer decorations;
+            };
+            // renderResources: resources of the context `output`(nullptr: offscreen rendering of the main thread) renders with.
+            // Initialized outputs keep a pointer to theirs, no lock or lookup is involved for them
+            OutputRenderResources& renderResources(LOutput* output);
+            // releaseRenderState: drop GL objects of an output when its context is destroyed. The context must be current.
+            void releaseRenderState(const LOutput* output);
 
             void initOpenGLResources();
             void uninitOpenGLResources();
@@ -67,11 +87,14 @@ namespace tiley{
             TileyServer(const TileyServer&) = delete;
             TileyServer& operator=(const TileyServer&) = delete;
 
-            std::unique_ptr<Shader> m_roundedCornerShader;
+            DamageAccumulator m_damage;
+            std::unique_ptr<RoundedCornerShader> m_roundedCornerShader;
+            std::unique_ptr<WindowInteriorShader> m_windowInteriorShader;
             // command to execute after Tiley launches
             std::vector<std::string> startUpCMD;
 
-            GLuint m_quadVBO { 0 };
-            GLuint m_quadEBO { 0 };
+            // resources of contexts without an initialized output(and of outputs before they cache theirs)
+            std::unordered_map<const LOutput*, OutputRenderResources> m_renderStates;
+            std::mutex m_renderStatesMutex;
     };
 }
\ No newline at end of file
@@ -3,10 +3,13 @@
 #include "src/lib/client/views/SurfaceView.hpp"
 #include "src/lib/core/Container.hpp"
 #include "src/lib/input/Pointer.hpp"
+#include "src/lib/input/SurfaceIndex.hpp"
+#include "src/lib/layout/LayoutEngine.hpp"
 #include "src/lib/ipc/IPCManager.hpp"
 #include "src/lib/surface/Surface.hpp"
 #include "src/lib/types.hpp"
 #include "src/lib/output/Output.hpp"
+#include "src/test/TraceZone.hpp"
 
 #include <LCursor.h>
 #include <LSeat.h>
@@ -18,8 +21,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
-#include <functional> 
 
 using namespace tiley;
 
@@ -29,33 +33,68 @@ UInt32 TileyWindowStateManager::getWorkspace(Container* container) const{
         return CURRENT_WORKSPACE;
     }
 
-    // trace up to root
-    Container* root = container;
-    while(root->parent){
-        root = root->parent;
+    // kept up to date by insertTile, detached containers remember their last workspace
+    return container->workspaceId;
+}
+
+void TileyWindowStateManager::assignWorkspace(Container* container, UInt32 workspace){
+    container->workspaceId = workspace;
+    if(container->window){
+        static_cast<ToplevelRole*>(container->window)->workspaceId = workspace;
     }
+}
+
+bool TileyWindowStateManager::validateLayoutRequested(){
+    const char* env = getenv("TILEY_VALIDATE_LAYOUT");
+    return env && strcmp(env, "1") == 0;
+}
+
+bool TileyWindowStateManager::validateWorkspaceIds() const{
+
+    bool valid = true;
+
+    auto validate = [&valid](auto& self, const LayoutNode* node, const LayoutNode* parent, UInt32 workspace) -> void {
+        if(!node){
+            return;
+        }
+        if(node->parent() != parent){
+            LLog::error("[validateWorkspaceIds]: node %p of workspace %u has a wrong parent", (const void*)node, workspace);
+            valid = false;
+        }
+        if(node->isLeaf()){
+            const Container* container = static_cast<const Container*>(node);
+            if(container->workspaceId != workspace){
+                LLog::error("[validateWorkspaceIds]: container %p stores workspace %u but resides in workspace %u",
+                            (const void*)container, container->workspaceId, workspace);
+                valid = false;
+            }
+            return;
+        }
+        self(self, node->child1(), node, workspace);
+        self(self, node->child2(), node, workspace);
+    };
 
     for(UInt32 w = 0; w < WORKSPACES; w++){
-        if(workspaceRoots[w] == root){
-            return w;
+        if(workspaceRoots[w]){
+            validate(validate, workspaceRoots[w]->child1(), workspaceRoots[w], w);
+            validate(validate, workspaceRoots[w]->child2(), workspaceRoots[w], w);
         }
     }
 
-    LLog::error("Error: Cannot find a root of target container. This may be a critical bug, please report.");
-    return CURRENT_WORKSPACE;
-
+    return valid;
 }
 
 
 void TileyWindowStateManager::setActiveContainer(Container* container){
+    markStateChanged();
     if(!container){
-        activeContainer = container;
+        activeContainer = {};
         return;
     }
 
     UInt32 workspace = getWorkspace(container);
     if(workspace >= 0 && workspace < WORKSPACES){
-        workspaceActiveContainers[workspace] = container;
+        workspaceActiveContainers[workspace] = container->handle();
     }
 
     // compatibility: assign activeContainer to currently activated container.
@@ -65,8 +104,6 @@ void TileyWindowStateManager::setActiveContainer(Container* container){
 
 bool TileyWindowStateManager::insertTile(UInt32 workspace, Container* newWindowContainer, Container* targetContainer, SPLIT_TYPE splitType, Float32 splitRatio){
 
-    L_UNUSED(workspace);
-
     if(targetContainer == nullptr){
         LLog::debug("Target container is null, stop inserting");
         return false;
@@ -82,86 +119,56 @@ bool TileyWindowStateManager::insertTile(UInt32 workspace, Container* newWindowC
         return false;
     }
 
-    if(targetContainer->window == nullptr){
-        LLog::debug("Target container must be typed window, stop inserting");
-        return false;
-    }
+    // the cursor decides which half the new window takes
+    const LPointF& mouse = cursor()->pos();
 
-    auto parent = targetContainer->parent;
-    
-    auto splitContainer = new Container();
-    splitContainer->splitType = splitType;
-    splitContainer->splitRatio = splitRatio;
-
-    if(parent->child1 == targetContainer){
-        parent->child1 = splitContainer;
-        splitContainer->parent = parent;
-    }else if(parent->child2 == targetContainer){
-        parent->child2 = splitContainer;
-        splitContainer->parent = parent;
-    }else{
-        // Any exception?
-    }
-
-    // TODO: move cursor access to where before calling `insertTile` for separation of data and environment
-    const LRect& geo = targetContainer->geometry;
-    LPointF mouse = cursor()->pos();
-    bool before;
-
-    if (splitType == SPLIT_H) {
-        float midX = geo.x() + geo.w() * splitRatio;
-        before = (mouse.x() < midX);
-    } else {
-        float midY = geo.y() + geo.h() * splitRatio;
-        before = (mouse.y() < midY);
+    if(!LayoutEngine::insert(targetContainer, newWindowContainer, splitType, splitRatio, {mouse.x(), mouse.y()})){
+        LLog::error("[insertTile]: failed to split target container, this may be a bug, please report");
+        return false;
     }
 
-    if (before) {
-        splitContainer->child1 = newWindowContainer;
-        splitContainer->child2 = targetContainer;
-        //LLog::debug("Cursor at first part");
-    } else {
-        splitContainer->child1 = targetContainer;
-        splitContainer->child2 = newWindowContainer;
-        //LLog::debug("Cursor at second part");
+    // the new window joins the tree of its target, which is the one to trust if `workspace` disagrees
+    UInt32 targetWorkspace = getWorkspace(targetContainer);
+    if(targetWorkspace != workspace){
+        LLog::debug("[insertTile]: target container resides in workspace %u instead of %u", targetWorkspace, workspace);
     }
-    
-    newWindowContainer->parent = splitContainer;
-    targetContainer->parent = splitContainer;
-    LLog::debug("%d, %d, %d, %d",geo.x(),geo.y(),geo.w(),mouse.x());
+    assignWorkspace(newWindowContainer, targetWorkspace);
 
-    // accumulate trace amount
-    containerCount += 2;
+    // accumulate trace amount: the new window and its splitting container
+    workspaceNodeCounts[newWindowContainer->workspaceId] += 2;
 
     return true;
 }
 
 bool TileyWindowStateManager::insertTile(UInt32 workspace, Container* newWindowContainer, Float32 splitRatio){
 
-    Container* targetContainer = getInsertTargetTiledContainer(workspace);
+    LayoutNode* target = getInsertTargetTiledContainer(workspace);
 
-    // if targetContainer is root, insert directly after desktop node
-    if(targetContainer == workspaceRoots[workspace]){
+    // if target is root, insert directly after desktop node
+    if(target == workspaceRoots[workspace]){
         LLog::debug("No window presents, insert after desktop container");
-        workspaceRoots[workspace]->child1 = newWindowContainer;
-        newWindowContainer->parent = workspaceRoots[workspace];
-        containerCount += 1;
+        if(!LayoutEngine::insertToRoot(workspaceRoots[workspace], newWindowContainer)){
+            return false;
+        }
+        assignWorkspace(newWindowContainer, workspace);
+        workspaceNodeCounts[workspace] += 1;
         return true;
     }
 
-    if(targetContainer){
+    if(target){
         LLog::debug("Found window at cursor position");
+        Container* targetContainer = static_cast<Container*>(target);
         Surface* windowSurface = static_cast<Surface*>(targetContainer->window->surface());
         SPLIT_TYPE split = windowSurface->size().w() >= windowSurface->size().h() ? SPLIT_H : SPLIT_V;
-        return insertTile(workspace, newWindowContainer, ((ToplevelRole*)windowSurface->toplevel())->container, split, splitRatio);   
+        return insertTile(workspace, newWindowContainer, targetContainer, split, splitRatio);   
     }
 
     // try inserting after last activated container if failed to find targetContainer
-    if(activeContainer != nullptr){
+    if(Container* lastActive = activatedContainer()){
         LLog::debug("insert after last activated container");
-        const LRect& size = activeContainer->window->surface()->size();
+        const LRect& size = lastActive->window->surface()->size();
         SPLIT_TYPE split = size.w() >= size.h() ? SPLIT_H : SPLIT_V; 
-        return insertTile(workspace, newWindowContainer, activeContainer, split, splitRatio);
+        return insertTile(workspace, newWindowContainer, lastActive, split, splitRatio);
     }
     // Any other situations?
 
@@ -170,8 +177,7 @@ bool TileyWindowStateManager::insertTile(UInt32 workspace, Container* newWindowC
 }
 
 Container* TileyWindowStateManager::detachTile(LToplevelRole* window, FLOATING_REASON reason){
-
-    // TODO: merge identical logical parts of `detachTile` and `removeTile`
+    markStateChanged();
 
     if(window == nullptr){
         LLog::debug("[detachTile]: target window is null, stop detaching");
@@ -179,11 +185,8 @@ Container* TileyWindowStateManager::detachTile(LToplevelRole* window, FLOATING_R
     }
 
     Container* containerToDetach = ((ToplevelRole*)window)->container;
-    // Save parent and grandParent pointers for later use
-    Container* grandParent = containerToDetach->parent->parent;
-    Container* parent = containerToDetach->parent;
 
-    if(containerToDetach == nullptr){
+    if(containerToDetach == nullptr || containerToDetach->parent() == nullptr){
         LLog::warning("[detachTile]: target window is not inside a container? This may be a bug, please report");
         return nullptr;
     }
@@ -191,55 +194,19 @@ Container* TileyWindowStateManager::detachTile(LToplevelRole* window, FLOATING_R
     // TODO: Move to a better place for separation of data and environment
     window->surface()->raise();
 
-    if(grandParent == nullptr){
-        Container* sibling = (parent->child1 == containerToDetach) ? parent->child2 : parent->child1;
-        if(sibling == nullptr){
-
-            LLog::debug("[detachTile]: detach last window");
-            parent->child1 = nullptr;
-        
-        }else{
-
-            LLog::debug("[detachTile]: only one window remaining after detaching");
-            parent->child1 = sibling;
-            parent->child2 = nullptr;
-            sibling->parent = parent;
-            containerCount -= 1;
-
-        }
-
-        // Accumulating checksum count
-        containerCount -= 1;
-
-        containerToDetach->parent = nullptr;
-        containerToDetach->floating_reason = reason;
-        return containerToDetach;
-    }
-    
-    Container* sibling = (parent->child1 == containerToDetach) ? parent->child2 : parent->child1;
-
-    if (grandParent->child1 == parent) {
-        grandParent->child1 = sibling;
-    } else {
-        grandParent->child2 = sibling;
-    }
-
-    if (sibling != nullptr) {
-        sibling->parent = grandParent;
-    }
-
-    containerToDetach->parent = nullptr;
-    containerToDetach->floating_reason = reason;
-    delete parent;
-    parent = nullptr;
+    UInt32 workspace = getWorkspace(containerToDetach);
+    UInt32 removed = 0;
+    LayoutEngine::detach(containerToDetach, removed);
 
     // Accumulating checksum count
-    containerCount -= 2;
+    workspaceNodeCounts[workspace] -= removed;
 
+    containerToDetach->floating_reason = reason;
     return containerToDetach;
 };
 
 bool TileyWindowStateManager::attachTile(LToplevelRole* window){
+    markStateChanged();
 
     // Call `insertTile` directly cause logics are nearly the same
 
@@ -263,9 +230,7 @@ bool TileyWindowStateManager::attachTile(LToplevelRole* window){
     return inserted;
 }
 
-Container* TileyWindowStateManager::removeTile(LToplevelRole* window){
-
-    Container* result = nullptr;
+LayoutNode* TileyWindowStateManager::removeTile(LToplevelRole* window){
 
     if(!window){
         LLog::debug("[removeTile]: target window is null, stop removing");
@@ -273,69 +238,28 @@ Container* TileyWindowStateManager::removeTile(LToplevelRole* window){
     }
 
     Container* containerToRemove = ((ToplevelRole*)window)->container;
-    
-    if(containerToRemove->floating_reason != NONE){
-        LLog::debug("[removeTile]: removing a floating window");
-        delete containerToRemove;
-        containerToRemove = nullptr;
-        return nullptr;
-    }
-    
-    Container* grandParent = containerToRemove->parent->parent;
-    Container* parent = containerToRemove->parent;
 
     if(containerToRemove == nullptr){
         LLog::warning("[removeTile]: target window is not inside a container? This may be a bug, please report");
         return nullptr;
     }
-
-    if(grandParent == nullptr){
-        Container* sibling = (parent->child1 == containerToRemove) ? parent->child2 : parent->child1;
-        if(sibling == nullptr){
-            LLog::debug("[removeTile]: removing last existing window");
-            parent->child1 = nullptr;
-            result = workspaceRoots[getWorkspace(containerToRemove)];
-        }else{
-            LLog::debug("[removeTile]: only one window remains after removing");
-            parent->child1 = sibling;
-            parent->child2 = nullptr;
-            sibling->parent = parent;
-            // Accumulating checksum count
-            containerCount -= 1;
-            result = sibling;
-        }
-
-        delete containerToRemove;
-        containerToRemove = nullptr;
-
-        // Accumulating checksum count
-        containerCount -= 1;
-
-        return result;
-    }
     
-    Container* sibling = (parent->child1 == containerToRemove) ? parent->child2 : parent->child1;
-
-    // parent reclaims its children 
-    if (grandParent->child1 == parent) {
-        grandParent->child1 = sibling;
-    } else {
-        grandParent->child2 = sibling;
+    if(containerToRemove->floating_reason != NONE){
+        LLog::debug("[removeTile]: removing a floating window");
+        destroyContainer(containerToRemove);
+        return nullptr;
     }
 
-    if (sibling != nullptr) {
-        sibling->parent = grandParent;
-        result = sibling;
-    }
+    UInt32 workspace = getWorkspace(containerToRemove);
+    UInt32 removed = 0;
+    // sibling taking the place of removed window, or root if it is the last window
+    LayoutNode* result = LayoutEngine::detach(containerToRemove, removed);
 
-    containerToRemove->parent = nullptr;
-    delete parent;
-    delete containerToRemove;
-    parent = nullptr;
+    destroyContainer(containerToRemove);
     containerToRemove = nullptr;
 
     // Accumulating checksum count
-    containerCount -= 2;
+    workspaceNodeCounts[workspace] -= removed;
 
     return result;
 
@@ -350,24 +274,12 @@ bool TileyWindowStateManager::resizeTile(LPointF cursorPos){
 
     // cursor dragging horizontally
     if (resizingHorizontalTarget) {
-        double totalWidth = resizingHorizontalTarget->geometry.w();
-        if (totalWidth >= 1) {
-            double ratioDelta = mouseDelta.x() / totalWidth;
-            double newRatio = initialHorizontalRatio + ratioDelta;
-            resizingHorizontalTarget->splitRatio = std::min(0.95, std::max(0.05, newRatio));
-            resized = true;
-        }
+        resized |= LayoutEngine::resize(resizingHorizontalTarget, initialHorizontalRatio, mouseDelta.x());
     }
 
     // cursor dragging vertically
     if (resizingVerticalTarget) {
-        double totalHeight = resizingVerticalTarget->geometry.h();
-        if (totalHeight >= 1) {
-            double ratioDelta = mouseDelta.y() / totalHeight;
-            double newRatio = initialVerticalRatio + ratioDelta;
-            resizingVerticalTarget->splitRatio = std::min(0.95, std::max(0.05, newRatio));
-            resized = true;
-        }
+        resized |= LayoutEngine::resize(resizingVerticalTarget, initialVerticalRatio, mouseDelta.y());
     }
 
     if (resized) {
@@ -390,131 +302,48 @@ void TileyWindowStateManager::printContainerHierachy(UInt32 workspace){
     LLog::log("***************************************");
 }
 
-void TileyWindowStateManager::_printContainerHierachy(Container* current){
+void TileyWindowStateManager::_printContainerHierachy(LayoutNode* current){
     
     if(!current){
         return;
     }
+
+    Container* container = current->isLeaf() ? static_cast<Container*>(current) : nullptr;
+
     LLog::log("container: %d, type: %s, parent: %d, child1: %d, child2: %d, active monitor: %d", 
                         current, 
-                        current->window != nullptr ? "window" : "container", 
-                        current->parent, 
-                        current->child1, 
-                        current->child2,
-                        current->window ? ((ToplevelRole*)current->window)->output : nullptr
+                        container != nullptr ? "window" : "container", 
+                        current->parent(), 
+                        current->child1(), 
+                        current->child2(),
+                        container ? ((ToplevelRole*)container->window)->output : nullptr
     );
 
-    if(current->child1){
-        _printContainerHierachy(current->child1);
+    if(current->child1()){
+        _printContainerHierachy(current->child1());
     }
-    if(current->child2){
-        _printContainerHierachy(current->child2);
+    if(current->child2()){
+        _printContainerHierachy(current->child2());
     }
 }
 
 
 void TileyWindowStateManager::reflow(UInt32 workspace, const LRect& region, bool& success){
+    TILEY_TRACE_ZONE("TileyWindowStateManager::reflow");
     LLog::debug("[reflow]: recalculate geometry of tiled windows");
     // 调试: 打印当前容器树
     //printContainerHierachy(workspace);
 
-    UInt32 accumulateCount = 0;
-
-    _reflow(workspaceRoots[workspace], region, accumulateCount);
+    markStateChanged();
+    // only dirty subtrees are visited, windows keeping their geometry are not configured again
+    UInt32 accumulateCount = LayoutEngine::reflow(workspaceRoots[workspace], {region.x(), region.y(), region.w(), region.h()});
 
-    success = (accumulateCount == containerCount);
+    success = accumulateCount <= workspaceNodeCounts[workspace];
 
-    LLog::debug("Amount of containers: %d", containerCount);
+    LLog::debug("Amount of containers: %d", workspaceNodeCounts[workspace]);
     LLog::debug("Recalculated containers: %d", accumulateCount);
     if(!success){
-        LLog::error("[reflow]: Warning: count of recalculated containers is not equal to total containers");
-    }
-}
-
-void TileyWindowStateManager::_reflow(Container* container, const LRect& areaRemain, UInt32& accumulateCount){
-
-    if (container == nullptr) { 
-        return;
-    }
-
-    container->geometry = areaRemain;
-
-    // window visual gap
-    const Int32 GAP = 5;
-
-    if(container->window){
-        LLog::debug("[reflow]: window recalculated, size: %dx%d, pos: (%d,%d)", areaRemain.w(), areaRemain.h(), areaRemain.x(), areaRemain.y());
-        
-        Surface* surface = static_cast<Surface*>(container->window->surface());
-        
-        // TODO: clients heartbeat detection
-        /*
-        ToplevelRole* toplevel = static_cast<ToplevelRole*>(container->window);
-        if (toplevel->pendingConfiguration().serial != 0 &&
-            toplevel->serial() != toplevel->pendingConfiguration().serial){
-            LLog::debug("Client still processes last serial: %u, skip configuration", toplevel->pendingConfiguration().serial);
-            return;
-        }
-        */
-        
-        if(surface->mapped()){
-            const LRect& areaWithGaps = areaRemain;
-
-            LRect areaForWindow = {
-                areaWithGaps.x() + GAP,
-                areaWithGaps.y() + GAP,
-                areaWithGaps.w() - GAP * 2,
-                areaWithGaps.h() - GAP * 2
-            };
-
-            // avoid negative geometry of windows too small
-            if (areaForWindow.w() < 50) areaForWindow.setW(50);
-            if (areaForWindow.h() < 50) areaForWindow.setH(50);
-
-            container->containerView->setPos(areaForWindow.pos());
-            container->containerView->setSize(areaForWindow.size());
-
-            surface->setPos(areaRemain.pos());
-            container->window->configureSize(areaForWindow.size());
-            container->window->setExtraGeometry({GAP, GAP, GAP, GAP});
-            
-            LLog::debug("[reflow]: children of containerView: %zu", container->containerView->children().size());
-            SurfaceView* surfaceView = static_cast<SurfaceView*>(container->containerView->children().front());
-
-            const LRect& windowGeometry = container->window->windowGeometry();
-
-            // if window does not support server side decorations and window draws its own decorations
-            if(!container->window->supportServerSideDecorations() && (windowGeometry.x() > 0 || windowGeometry.y() > 0)){
-                // set a custom position to align main part of window to upper-left corner
-                surfaceView->setCustomPos(-windowGeometry.x(), -windowGeometry.y());
-            }
-
-            compositor()->repaintAllOutputs();
-        }
-
-        accumulateCount += 1;
-
-    }else if(!container->window){
-
-        LRect area1, area2;
-        LLog::debug("[reflow]: container recalculated, type: %d, ratio: %f, size: %dx%d", container->splitType, container->splitRatio, container->geometry.width(), container->geometry.height());
-        if(container->splitType == SPLIT_H){
-            Int32 child1Width = (Int32)(areaRemain.width() * (container->splitRatio));
-            Int32 child2Width = (Int32)(areaRemain.width() - child1Width);
-            // potential rounding errors?
-            area1 = {areaRemain.x(),areaRemain.y(),child1Width,areaRemain.height()};
-            area2 = {areaRemain.x() + child1Width, areaRemain.y(), child2Width, areaRemain.height()};
-        }else if(container->splitType == SPLIT_V){
-            Int32 child1Height = (Int32)(areaRemain.height() * (container->splitRatio));
-            Int32 child2Height = (Int32)(areaRemain.height() - child1Height);
-            area1 = {areaRemain.x(),areaRemain.y(), areaRemain.width(), child1Height};
-            area2 = {areaRemain.x(),areaRemain.y() + child1Height,areaRemain.width(), child2Height};
-        }
-
-        accumulateCount += 1;
-
-        _reflow(container->child1, area1, accumulateCount);
-        _reflow(container->child2, area2, accumulateCount);
+        LLog::error("[reflow]: Warning: count of recalculated containers is larger than total containers");
     }
 }
 
@@ -543,8 +372,12 @@ bool TileyWindowStateManager::addWindow(ToplevelRole* window, Container* &contai
     // print geometry debug info
     //surface->printWindowGeometryDebugInfo(activeOutput, availableGeometry);
 
+    markStateChanged();
+
     // TODO: Allow add window to other inactive outputs
     window->output = activeOutput;
+    // tiled windows get the workspace of the tree they are inserted into below
+    window->workspaceId = CURRENT_WORKSPACE;
 
     switch (window->type) {
         case FLOATING:
@@ -555,7 +388,7 @@ bool TileyWindowStateManager::addWindow(ToplevelRole* window, Container* &contai
         }
         case NORMAL:{
             LLog::debug("[addWindow]: added a common window, address of surface object: %d, layer: %d", surface, surface->layer());
-            Container* newContainer = new Container(window);
+            Container* newContainer = createContainer(window);
             insertTile(CURRENT_WORKSPACE, newContainer, 0.5);
             reapplyWindowState(window);
             container = newContainer;
@@ -565,12 +398,11 @@ bool TileyWindowStateManager::addWindow(ToplevelRole* window, Container* &contai
             LLog::warning("[addWindow]: warning: added a unknown window, this will not be handled by manager");
     }
 
-    window->workspaceId = CURRENT_WORKSPACE;
-
     return true;
 }
 
-bool TileyWindowStateManager::removeWindow(ToplevelRole* window, Container*& container){
+bool TileyWindowStateManager::removeWindow(ToplevelRole* window, LayoutNode*& container){
+    markStateChanged();
     switch(window->type){
         case FLOATING:
         case RESTRICTED_SIZE: {
@@ -578,7 +410,7 @@ bool TileyWindowStateManager::removeWindow(ToplevelRole* window, Container*& con
             break;
         }
         case NORMAL:{
-            Container* lastActiveContainer = removeTile(window);
+            LayoutNode* lastActiveContainer = removeTile(window);
             if(lastActiveContainer != nullptr){
                 container = lastActiveContainer;
                 return true;
@@ -643,6 +475,7 @@ bool TileyWindowStateManager::reapplyWindowState(ToplevelRole* window){
 }
 
 bool TileyWindowStateManager::toggleStackWindow(ToplevelRole* window){
+    markStateChanged();
 
     if(!window || !window->container){
         LLog::debug("[toggleStackWindow]: target window and it's container should not be null, stop toggling");
@@ -663,7 +496,7 @@ bool TileyWindowStateManager::toggleStackWindow(ToplevelRole* window){
         Container* detachedContainer = detachTile(window, STACKING);
         if(detachedContainer){
             reapplyWindowState(window);
-            recalculate();
+            scheduleRecalculate();
         }
         return detachedContainer != nullptr;
     }else if(window->container->floating_reason == STACKING){
@@ -671,7 +504,7 @@ bool TileyWindowStateManager::toggleStackWindow(ToplevelRole* window){
         // TODO: Allow inserting to other inactive workspaces
         if(attached){
             reapplyWindowState(window);
-            recalculate();
+            scheduleRecalculate();
         }
         return attached;
     }
@@ -687,66 +520,67 @@ Container* TileyWindowStateManager::getFirstWindowContainer(UInt32 workspace){
         return nullptr;
     }
 
-    Container* root = workspaceRoots[workspace];
-    Container* result = nullptr;
+    LayoutNode* root = workspaceRoots[workspace];
 
-    if(root && !root->child1 && !root->child2){
+    if(root && !root->child1() && !root->child2()){
         LLog::debug("[getFirstWindowContainer]: no window exists in target workspace, return nullptr");
         return nullptr;
-    // if only one child presents
-    }else if(root && root->child1 && root->child1->window){
-        return root->child1;
-    // if more than one children presents
-    }else if(root && root->child1 && !root->child1->window){
-        result =  _getFirstWindowContainer(root);
     }
 
+    // every leaf inside a workspace tree is a window container
+    Container* result = static_cast<Container*>(LayoutEngine::firstLeaf(root));
+
     if(result == nullptr){
         LLog::debug("[getFirstWindowContainer]: cannot find root container of workspace: %d, returning nullptr", workspace);
     }
     return result;
 }
 
-Container* TileyWindowStateManager::_getFirstWindowContainer(Container* container){
-    
-    if(container->child1 != nullptr){
-        return _getFirstWindowContainer(container->child1);
+bool TileyWindowStateManager::recalculate(){
+    bool success = recalculate(CURRENT_WORKSPACE);
+    // windows no longer request repaints by themselves, do it once for the output of the workspace
+    if(Output* output = workspaceOutput(CURRENT_WORKSPACE)){
+        TileyServer::getInstance().damage().add(output->availableGeometry());
     }
-    if(container->child1 == nullptr && container->child2 == nullptr && container->window){
-        return container;
+    return success;
+}
+
+Output* TileyWindowStateManager::workspaceOutput(UInt32 workspace){
+
+    Output* output = nullptr;
+    if (auto* first = getFirstWindowContainer(workspace)) {
+        output = static_cast<ToplevelRole*>(first->window)->output;
     }
-    if(container->child2 != nullptr){
-        return _getFirstWindowContainer(container->child2);
+    if (!output) {
+        output = static_cast<Output*>(cursor()->output());
     }
-
-    return nullptr;
+    return output;
 }
 
-bool TileyWindowStateManager::recalculate(){
+bool TileyWindowStateManager::recalculate(UInt32 workspace){
+    TILEY_TRACE_ZONE("TileyWindowStateManager::recalculate");
+
+    if(workspace >= WORKSPACES){
+        LLog::warning("[recalculate]: target workspace id %u is out of range, stop recalculating", workspace);
+        return false;
+    }
 
-    UInt32 workspace = CURRENT_WORKSPACE;
-    Container* root = workspaceRoots[workspace];
+    LayoutNode* root = workspaceRoots[workspace];
 
     if (!root) {
         LLog::warning("[recalculate]: warning: root container of workspace id %u is null, this may be a bug, please report", workspace);
         return false;
     }
 
-    if (!root->child1 && !root->child2) {
+    if (!root->child1() && !root->child2()) {
         LLog::debug("[recalculate]: no window exists in workspace id: %u, unable to recalculate layout", workspace);
         return false;
     }
 
-    LLog::log("Currently recalculate layout for workspace id: %d", workspace);
+    LLog::debug("Currently recalculate layout for workspace id: %d", workspace);
 
     // Get root container of a workspace
-    Output* rootOutput = nullptr;
-    if (auto* first = getFirstWindowContainer(workspace)) {
-        rootOutput = static_cast<ToplevelRole*>(first->window)->output;
-    }
-    if (!rootOutput) {
-        rootOutput = static_cast<Output*>(cursor()->output());
-    }
+    Output* rootOutput = workspaceOutput(workspace);
     if (!rootOutput) {
         LLog::warning("[recalculate]: no monitor available for workspace id %u, giving up", workspace);
         return false;
@@ -754,10 +588,12 @@ bool TileyWindowStateManager::recalculate(){
 
     const LRect& availableGeometry = rootOutput->availableGeometry();
 
-    containerCount = countContainersOfWorkspace(root);   
-
     bool reflowSuccess = false;
-    LLog::debug("[recalculate]: executing reflow... ws=%u, nodes=%u", workspace, containerCount);
+    LLog::debug("[recalculate]: executing reflow... ws=%u, nodes=%u", workspace, workspaceNodeCounts[workspace]);
+
+    if(m_validateLayout && !validateWorkspaceIds()){
+        LLog::error("[recalculate]: workspace ids of containers are inconsistent, this may be a bug, please report");
+    }
 
     reflow(workspace, availableGeometry, reflowSuccess);
     if (reflowSuccess){
@@ -769,25 +605,45 @@ bool TileyWindowStateManager::recalculate(){
     }
 }
 
+void TileyWindowStateManager::scheduleRecalculate(UInt32 workspace){
 
-UInt32 TileyWindowStateManager::countContainersOfWorkspace(const Container* root) {
-    if (!root) return 0;
+    if(workspace >= WORKSPACES){
+        LLog::warning("[scheduleRecalculate]: target workspace id %u is out of range, stop scheduling", workspace);
+        return;
+    }
 
-    UInt32 n = 0;
-    std::function<void(const Container*)> dfs = [&](const Container* c){
-        if (!c) return;
-        
-        // count container whether it is a 'container' or a 'window'
-        ++n;
-        dfs(c->child1);
-        dfs(c->child2);
-    };
+    // the first change of a frame asks for the frame, later ones just join the transaction.
+    // Only a frame is needed, windows damage their area once the transaction commits.
+    if(pendingReflows.none()){
+        if(Output* output = workspaceOutput(workspace)){
+            output->repaint();
+        }else{
+            compositor()->repaintAllOutputs();
+        }
+    }
 
-    dfs(root);
-    return n;
+    pendingReflows.set(workspace);
 }
 
+bool TileyWindowStateManager::flushScheduledReflows(){
+
+    if(pendingReflows.none()){
+        return false;
+    }
+
+    // take the whole batch first, windows configured below may schedule again for the next frame
+    std::bitset<WORKSPACES> workspaces = pendingReflows;
+    pendingReflows.reset();
+
+    // windows are only configured here, the layout transaction moves them and requests repaints once clients acked
+    for(UInt32 workspace = 0; workspace < WORKSPACES; workspace++){
+        if(workspaces.test(workspace)){
+            recalculate(workspace);
+        }
+    }
 
+    return true;
+}
 
 
 // 获取下一个要显示的平铺窗口的插入目标容器
@@ -795,12 +651,12 @@ UInt32 TileyWindowStateManager::countContainersOfWorkspace(const Container* root
 // 因此, 该函数推荐在要插入新的窗口时紧跟着调用。如果不这样的话, 可能会出现目标和期望不一致的情况
 // 比如: 鼠标目前在这个位置, 但因为调用该函数过早/过晚, 导致鼠标位置和插入位置不一样的情况
 // 当然, 如果目标就是不跟随鼠标的(例如后期通过配置), 可以随时使用该函数而无碍
-Container* TileyWindowStateManager::getInsertTargetTiledContainer(UInt32 workspace){
+LayoutNode* TileyWindowStateManager::getInsertTargetTiledContainer(UInt32 workspace){
 
     // 函数分为两阶段逻辑: 一阶段直接返回由各种来源设置的"上一个活动容器"(通过setActiveContainer), 如果该容器不存在则进入二阶段回退, 计算鼠标坐标处的容器。
 
     // 特殊: 桌面根节点是所有的fallback
-    Container* root = workspaceRoots[workspace];
+    LayoutNode* root = workspaceRoots[workspace];
 
     if(!root){
         LLog::error("[getInsertTargetTiledContainer]: 工作区没有节点, 可能是bug, 停止获取鼠标处的容器");
@@ -808,52 +664,31 @@ Container* TileyWindowStateManager::getInsertTargetTiledContainer(UInt32 workspa
     }
 
     // 如果工作区为空, 直接返回自己
-    if(root->child1 == nullptr && root->child2 == nullptr){
+    if(root->child1() == nullptr && root->child2() == nullptr){
         LLog::debug("[getInsertTargetTiledContainer]: 返回工作区根节点");
         return root;
     }
 
-    // 一阶段, 命中缓存
-    Container* activeContainer = workspaceActiveContainers[workspace];
-    if(activeContainer){
+    // 一阶段, 命中缓存(已关闭窗口的句柄会失效)
+    Container* lastActive = m_containerPool.get(workspaceActiveContainers[workspace]);
+    if(lastActive){
         LLog::debug("[getInsertTargetTiledContainer]: 返回工作区 %u 上一个活动的Container", workspace);
-        return activeContainer;
+        return lastActive;
     }
 
     // 二阶段, 未命中缓存, 回退到鼠标位置查找
-    auto filter = [this](LSurface* s){
-        
-        auto surface = static_cast<Surface*>(s);
-
-        // 条件1: 必须是一个窗口
-        if(!surface->toplevel()){
-            return false;
-        }
+    // 复用本次鼠标位置的命中测试结果: 可见的、平铺中的非浮动窗口
+    LSurface* targetSurface = static_cast<Pointer*>(seat()->pointer())->hitTest(cursor()->pos()).tiledWindow;
 
-        // 条件2: 其视图必须可见
-        if(!surface->getView() || !surface->getView()->visible()){
-            return false;
-        }
-
-        // 条件3: 必须是可被平铺窗口和平铺中的非浮动窗口
-        auto window = static_cast<ToplevelRole*>(surface->toplevel());
-        if(window->type != NORMAL || (window->container && window->container->floating_reason != NONE)){
-            return false;
-        }
-
-        // 条件 4: 健壮性: 确保该窗口没有正在被移动
+    // 健壮性: 确保该窗口没有正在被移动
+    if(targetSurface){
         for (LToplevelMoveSession* session : seat()->toplevelMoveSessions()) {
-            if (s->toplevel() == session->toplevel()) {
-                return false;
+            if (targetSurface->toplevel() == session->toplevel()) {
+                targetSurface = nullptr;
+                break;
             }
         }
-
-        // 检查完全通过!
-        return true;
-
-    };
-
-    LSurface* targetSurface = static_cast<Pointer*>(seat()->pointer())->surfaceAtWithFilter(cursor()->pos(), filter);
+    }
     
     if (targetSurface) {
         // 找到了目标窗口
@@ -869,6 +704,91 @@ Container* TileyWindowStateManager::getInsertTargetTiledContainer(UInt32 workspa
 };
 
 
+bool TileyWindowStateManager::resizeTile(Container* container, bool horizontal, Int32 delta){
+
+    if(!container || !container->parent()){
+        LLog::debug("[resizeTile]: target container is not tiled, stop resizing");
+        return false;
+    }
+
+    UInt32 workspace = getWorkspace(container);
+    LayoutNode* horizontalTarget = nullptr;
+    LayoutNode* verticalTarget = nullptr;
+    LayoutEngine::findResizeTargets(container, workspaceRoots[workspace], horizontal, !horizontal, horizontalTarget, verticalTarget);
+
+    LayoutNode* target = horizontal ? horizontalTarget : verticalTarget;
+    if(!target){
+        LLog::debug("[resizeTile]: no split in this direction, stop resizing");
+        return false;
+    }
+
+    // the split line moves towards the second child when the first one grows
+    LayoutNode* side = container;
+    while(side->parent() != target){
+        side = side->parent();
+    }
+    const double signedDelta = side == target->child1() ? delta : -delta;
+
+    if(!LayoutEngine::resize(target, target->splitRatio(), signedDelta)){
+        return false;
+    }
+
+    markStateChanged();
+    scheduleRecalculate(workspace);
+    return true;
+}
+
+bool TileyWindowStateManager::focusTile(LEdge direction){
+
+    Container* from = activatedContainer();
+    if(!from || !from->parent() || getWorkspace(from) != CURRENT_WORKSPACE){
+        LLog::debug("[focusTile]: no tiled window is activated in the current workspace, stop focusing");
+        return false;
+    }
+
+    const LayoutRect& a = from->geometry();
+    Container* best = nullptr;
+    Int64 bestDistance = 0;
+
+    const auto visit = [&](auto& self, LayoutNode* node) -> void {
+        if(!node){
+            return;
+        }
+        if(!node->isLeaf()){
+            self(self, node->child1());
+            self(self, node->child2());
+            return;
+        }
+        if(node == from){
+            return;
+        }
+
+        // only windows beyond the edge and facing it are candidates
+        const LayoutRect& b = node->geometry();
+        const bool overlapsX = b.x < a.x + a.w && b.x + b.w > a.x;
+        const bool overlapsY = b.y < a.y + a.h && b.y + b.h > a.y;
+        Int64 distance = -1;
+        if(direction == LEdgeLeft && overlapsY && b.x + b.w <= a.x)          distance = a.x - (b.x + b.w);
+        else if(direction == LEdgeRight && overlapsY && b.x >= a.x + a.w)    distance = b.x - (a.x + a.w);
+        else if(direction == LEdgeTop && overlapsX && b.y + b.h <= a.y)      distance = a.y - (b.y + b.h);
+        else if(direction == LEdgeBottom && overlapsX && b.y >= a.y + a.h)   distance = b.y - (a.y + a.h);
+
+        if(distance >= 0 && (!best || distance < bestDistance)){
+            best = static_cast<Container*>(node);
+            bestDistance = distance;
+        }
+    };
+    visit(visit, workspaceRoots[CURRENT_WORKSPACE]);
+
+    if(!best || !best->window){
+        return false;
+    }
+
+    setActiveContainer(best);
+    reapplyWindowState(static_cast<ToplevelRole*>(best->window));
+    return true;
+}
+
 void TileyWindowStateManager::setupResizeSession(LToplevelRole* window, LBitset<LEdge> edges, const LPointF& cursorPos)
 {
     // 清空旧的上下文
@@ -877,27 +797,20 @@ void TileyWindowStateManager::setupResizeSession(LToplevelRole* window, LBitset<
     initialCursorPos = cursorPos;
 
     Container* container = static_cast<ToplevelRole*>(window)->container;
-    if (!container || !container->parent) return;
+    if (!container || !container->parent()) return;
 
-    Container* current = container;
     bool needsHorizontal = edges.check(LEdgeLeft) || edges.check(LEdgeRight);
     bool needsVertical = edges.check(LEdgeTop) || edges.check(LEdgeBottom);
 
-    while (current->parent && current->parent != workspaceRoots[CURRENT_WORKSPACE])
-    {
-        Container* parent = current->parent;
-        if (needsHorizontal && !resizingHorizontalTarget && parent->splitType == SPLIT_H) {
-            resizingHorizontalTarget = parent;
-            initialHorizontalRatio = parent->splitRatio; // 记录初始比例
-        }
-        if (needsVertical && !resizingVerticalTarget && parent->splitType == SPLIT_V) {
-            resizingVerticalTarget = parent;
-            initialVerticalRatio = parent->splitRatio; // 记录初始比例
-        }
-        if ((!needsHorizontal || resizingHorizontalTarget) && (!needsVertical || resizingVerticalTarget)) {
-            break;
-        }
-        current = parent;
+    LayoutEngine::findResizeTargets(container, workspaceRoots[CURRENT_WORKSPACE], needsHorizontal, needsVertical,
+                                    resizingHorizontalTarget, resizingVerticalTarget);
+
+    // 记录初始比例
+    if (resizingHorizontalTarget) {
+        initialHorizontalRatio = resizingHorizontalTarget->splitRatio();
+    }
+    if (resizingVerticalTarget) {
+        initialVerticalRatio = resizingVerticalTarget->splitRatio();
     }
 }
 
@@ -1011,34 +924,42 @@ void TileyWindowStateManager::initialize(){
         //    这会将线性的进度转换为非线性的、开始快结束慢的平滑曲线
         const Float64 easedValue = sin(linearValue * M_PI / 2.0);
 
-        // 获取主输出设备
-        auto* output = Louvre::compositor()->outputs().front();
+        // 获取当前工作区所在的输出设备
+        Output* output = workspaceOutput(CURRENT_WORKSPACE);
         if (!output) return;
 
         const int screenWidth = output->size().w();
 
         // 3. 在所有位置计算中使用我们处理过的 easedValue
         
+        // 窗口移动前后的位置都需要重绘, 只有显示这些区域的屏幕会被重绘
+        DamageAccumulator& damage = TileyServer::getInstance().damage();
+        const auto moveView = [&damage](LView* view, Int32 x, Int32 y){
+            damage.add(LRect(view->pos(), view->size()));
+            view->setPos(x, y);
+            damage.add(LRect(view->pos(), view->size()));
+        };
+        // windows slide under the cursor
+        SurfaceIndex::invalidateAll();
+
         // 更新滑出窗口的位置
         for (auto* window : m_slidingOutWindows) {
             if (window->container && window->container->getContainerView()) {
-                const auto& originalRect = window->container->geometry;
+                const LRect originalRect = window->container->getGeometry();
                 int newX = originalRect.x() + (m_switchDirection * screenWidth * easedValue); // <-- 使用 easedValue
-                window->container->getContainerView()->setPos(newX, originalRect.y());
+                moveView(window->container->getContainerView(), newX, originalRect.y());
             }
         }
 
         // 更新滑入窗口的位置
         for (auto* window : m_slidingInWindows) {
             if (window->container && window->container->getContainerView()) {
-                const auto& targetRect = window->container->geometry;
+                const LRect targetRect = window->container->getGeometry();
                 int startX = targetRect.x() - (m_switchDirection * screenWidth);
                 int newX = startX + (m_switchDirection * screenWidth * easedValue); // <-- 使用 easedValue
-                window->container->getContainerView()->setPos(newX, targetRect.y());
+                moveView(window->container->getContainerView(), newX, targetRect.y());
             }
         }
-        
-        output->repaint();
     });
 
     m_workspaceSwitchAnimation->setOnFinishCallback([this](Louvre::LAnimation*) {
@@ -1048,25 +969,33 @@ void TileyWindowStateManager::initialize(){
         for (auto* window : m_slidingOutWindows) {
             setWindowVisible(window, false);
             if (window->container && window->container->getContainerView()) {
-                window->container->getContainerView()->setPos(window->container->geometry.pos());
+                window->container->getContainerView()->setPos(window->container->getGeometry().pos());
             }
         }
 
         // 2. 确保所有滑入的窗口在它们的最终位置
         for (auto* window : m_slidingInWindows) {
              if (window->container && window->container->getContainerView()) {
-                window->container->getContainerView()->setPos(window->container->geometry.pos());
+                window->container->getContainerView()->setPos(window->container->getGeometry().pos());
             }
         }
+        SurfaceIndex::invalidateAll();
+
+        // 最终状态需要重绘一次
+        if (Output* output = workspaceOutput(CURRENT_WORKSPACE)) {
+            TileyServer::getInstance().damage().add(output->rect());
+        }
 
         // 3. 更新工作区状态 (这部分逻辑从旧的 switchWorkspace 移过来)
         CURRENT_WORKSPACE = m_targetWorkspace;
         activeContainer = workspaceActiveContainers[CURRENT_WORKSPACE];
+        markStateChanged();
 
         auto seat = Louvre::seat();
-        if(activeContainer && activeContainer->window){
+        Container* focusedContainer = activatedContainer();
+        if(focusedContainer && focusedContainer->window){
             /*if(!seat->keyboard()->grab()){
-                seat->keyboard()->setFocus(activeContainer->window->surface());
+                seat->keyboard()->setFocus(focusedContainer->window->surface());
             }*/
         } else {
             seat->keyboard()->setFocus(nullptr);
@@ -1095,21 +1024,44 @@ std::unique_ptr<TileyWindowStateManager, TileyWindowStateManager::WindowStateMan
 std::once_flag TileyWindowStateManager::onceFlag;
 
 TileyWindowStateManager::TileyWindowStateManager()
-  : workspaceRoots(WORKSPACES, nullptr){
+  : workspaceRoots(WORKSPACES, nullptr), workspaceNodeCounts(WORKSPACES, 1){
     // 为每个工作区创建一个根容器,并初始化为“桌面”状态
     for (int i = 0; i < WORKSPACES; ++i) {
-        Container* root = new Container();
-        root->splitType = SPLIT_H;
-        root->splitRatio = 1.0f;
-        workspaceRoots[i] = root;
+        workspaceRoots[i] = LayoutEngine::createRoot();
     }
-    containerCount += 1;
     
 }
 
 //删除对应根节点
 TileyWindowStateManager::~TileyWindowStateManager(){
+    // roots are released by `shutdown` once the compositor was running
     for (auto root : workspaceRoots) {
-        delete root;
+        LayoutEngine::destroyRoot(root);
+    }
+}
+
+void TileyWindowStateManager::shutdown(){
+    m_layoutTransaction.clear();
+
+    // splits first, the walk stops at leaves which are about to be destroyed
+    for (auto& root : workspaceRoots) {
+        LayoutEngine::destroyRoot(root);
+        root = nullptr;
+    }
+    m_containerPool.clear();
+}
+
+Container* TileyWindowStateManager::createContainer(ToplevelRole* window){
+    SlabHandle handle = m_containerPool.create(window);
+    Container* container = m_containerPool.get(handle);
+    container->m_handle = handle;
+    return container;
+}
+
+void TileyWindowStateManager::destroyContainer(Container* container){
+    // a closing window must not hold back the layout transaction until it times out
+    m_layoutTransaction.remove(container);
+    if(container){
+        m_containerPool.destroy(container->handle());
     }
 }
\ No newline at end of file
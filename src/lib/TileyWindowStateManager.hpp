@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <bitset>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -11,6 +13,9 @@
 #include "LToplevelRole.h"
 #include "src/lib/client/ToplevelRole.hpp"
 #include "src/lib/core/Container.hpp"
+#include "src/lib/core/LayoutTransaction.hpp"
+#include "src/lib/layout/LayoutNode.hpp"
+#include "src/lib/layout/SlabPool.hpp"
 #include "types.hpp"
 #include <LAnimation.h>
 
@@ -18,6 +23,7 @@ using namespace Louvre;
 
 namespace tiley{
     class Container;
+    class Output;
     class ToplevelRole;
 }
 
@@ -30,26 +36,44 @@ namespace tiley{
             bool insertTile(UInt32 workspace, Container* newWindowContainer, Float32 splitRatio);
             // insertTile: version for inserting at place where cursor not presents
             bool insertTile(UInt32 workspace, Container* newWindowContainer, Container* targetContainer, SPLIT_TYPE split, Float32 splitRatio);
-            // remove: remove a container when a tiling window is closed
-            Container* removeTile(LToplevelRole* window);
+            // remove: remove a container when a tiling window is closed, returns the node taking its place
+            LayoutNode* removeTile(LToplevelRole* window);
             // detach: detach a window for moving, stacking, etc.
             Container* detachTile(LToplevelRole* window, FLOATING_REASON reason = MOVING);
             // switchWorkspace
             bool switchWorkspace(UInt32 target);
             // currentWorkspace
             UInt32 currentWorkspace() const { return CURRENT_WORKSPACE; }
+            // switchingWorkspace: a switch animation is running, currentWorkspace() only changes once it ends
+            bool switchingWorkspace() const { return m_isSwitchingWorkspace; }
+            // targetWorkspace: the workspace being switched to, meaningful while switchingWorkspace()
+            UInt32 targetWorkspace() const { return m_targetWorkspace; }
             // attach: Oppsite to what detachTile does
             bool attachTile(LToplevelRole* window);
             // resizeTile: resizing tiling windows affected by user actions
             bool resizeTile(LPointF cursorPos);
+            // resizeTile: move the split line beside a tiled window by `delta` pixels(negative shrinks it), along the width if `horizontal`
+            bool resizeTile(Container* container, bool horizontal, Int32 delta);
+            // focusTile: activate the nearest tiled window of the current workspace towards `direction`
+            bool focusTile(LEdge direction);
             // setupResizeSession: call this when user start to resize windows(including floating ones)
             void setupResizeSession(LToplevelRole* window, LBitset<LEdge> edges, const LPointF& cursorPos);
-            // recalculate: re-layout.
+            // recalculate: re-layout the current workspace immediately. Prefer `scheduleRecalculate` when responding to events.
             bool recalculate();
+            // recalculate: re-layout a workspace immediately without requesting repaints
+            bool recalculate(UInt32 workspace);
+            // scheduleRecalculate: add a workspace to the layout pass of the next frame.
+            // However many changes happen before the frame, the workspace is laid out once.
+            void scheduleRecalculate(UInt32 workspace);
+            inline void scheduleRecalculate(){ scheduleRecalculate(CURRENT_WORKSPACE); }
+            // flushScheduledReflows: lay out scheduled workspaces. Called by outputs right before painting.
+            bool flushScheduledReflows();
+            // layoutTransaction: windows configured by reflows, waiting for clients before being moved
+            inline LayoutTransaction& layoutTransaction(){ return m_layoutTransaction; }
             // addWindow: add a window to management, `container` will be the added container if added to tiling layout. 
             bool addWindow(ToplevelRole* window, Container*& container);
-            // removeWindow: remove a window from management, `container` will be the removed container if removed from tiling layout. 
-            bool removeWindow(ToplevelRole* window, Container*& container);
+            // removeWindow: remove a window from management, `container` will be the node taking place of the removed window if removed from tiling layout. 
+            bool removeWindow(ToplevelRole* window, LayoutNode*& container);
             // toggleFloatWindow: toggle between stacking/tiling
             bool toggleStackWindow(ToplevelRole* window);
             // isTiledWindow: check if a window is tiled
@@ -59,55 +83,84 @@ namespace tiley{
             // setActiveContainer: set currently activated container. This container is the only trusted target of cursor/keyboard input, and window insertion.
             void setActiveContainer(Container* container);
             // activatedContainer: get the activated container 
-            inline Container* activatedContainer(){ return activeContainer; }
+            inline Container* activatedContainer(){ return m_containerPool.get(activeContainer); }
+            // createContainer: allocate a container for a tiled window from the container pool
+            Container* createContainer(ToplevelRole* window);
+            // destroyContainer: release a container, handles referencing it become stale
+            void destroyContainer(Container* container);
+            // shutdown: release layout state backed by the compositor(transaction timer, containers and their views)
+            // while it is still alive, called when the compositor is uninitialized
+            void shutdown();
+            // container: resolve a container handle, nullptr if the container has been destroyed
+            inline Container* container(SlabHandle handle) const { return m_containerPool.get(handle); }
             // getFirstWindowContainer: util method for get the root of a workspace
             Container* getFirstWindowContainer(UInt32 workspace);
-            // getWorkspace: get workspace in which the container resides.  
+            // getWorkspace: get workspace in which the container resides(or resided before being detached). O(1).
             UInt32 getWorkspace(Container* container) const;
+            // validateWorkspaceIds: debug check, every tiled container must store the workspace of the tree it is in
+            bool validateWorkspaceIds() const;
             // getInsertTargetTiledContainer: gracefully find the next insertion target container.
             // This will first call `activatedContainer` and fallback to match surfaces under cursor if failed.
-            Container* getInsertTargetTiledContainer(UInt32 workspace);
+            // Returns the workspace root if there is no window to split.
+            LayoutNode* getInsertTargetTiledContainer(UInt32 workspace);
             // reapplyWindowState: refresh state for a window. This will smartly change states(e.g. floating, activated) according to window conditions.
             bool reapplyWindowState(ToplevelRole* window);
             // printContainerHrerachy: debug method for printing container hierachy
             void printContainerHierachy(UInt32 workspace);
             // 
-            void _printContainerHierachy(Container* current);
+            void _printContainerHierachy(LayoutNode* current);
             // initialize: init the manager.
             void initialize();
+            // workspaceRoot: root of the tiling tree of a workspace
+            inline LayoutNode* workspaceRoot(UInt32 workspace) const { return workspace < WORKSPACES ? workspaceRoots[workspace] : nullptr; }
+            // workspaceOutput: output showing a workspace, the one under the cursor if the workspace is empty
+            Output* workspaceOutput(UInt32 workspace);
+            // stateGeneration: changes whenever something IPC clients can query changed(tree, geometry, focus, workspaces, windows, outputs)
+            inline UInt64 stateGeneration() const { return m_stateGeneration.load(std::memory_order_relaxed); }
+            // markStateChanged: thread-safe, outputs call it from their render threads
+            inline void markStateChanged(){ m_stateGeneration.fetch_add(1, std::memory_order_relaxed); }
 
         private:
+            // assignWorkspace: record the workspace of a container and its window
+            void assignWorkspace(Container* container, UInt32 workspace);
             // reflow: assign regions for windows
             void reflow(UInt32 workspace, const LRect& region, bool& success);
-            //
-            void _reflow(Container* container, const LRect& areaRemain, UInt32& accumulateCount);
-            //
-            Container* _getFirstWindowContainer(Container* container);
             // TODO: Ensure CURRENT_WORKSPACE is always the proper workspace for the next user action.
             UInt32 CURRENT_WORKSPACE=0;
 
             // update order: workspaceActiveContainers -> activeContainer;
             // TOOD: use workspaceActiveContainers[index] only, activeContainer will be deprecated
-            Container* activeContainer;
+            SlabHandle activeContainer;
             // array for activated container of every workspace
-            std::vector<Container*> workspaceActiveContainers{WORKSPACES};
+            std::vector<SlabHandle> workspaceActiveContainers = std::vector<SlabHandle>(WORKSPACES);
             // roots for every workspace
-            std::vector<Container*> workspaceRoots{WORKSPACES};
+            std::vector<LayoutNode*> workspaceRoots{WORKSPACES};
 
             // set visiblity of a window
             void setWindowVisible(ToplevelRole* window, bool visible);
-            static UInt32 countContainersOfWorkspace(const Container* root);
-            // checksum for recalculating windows count
-            UInt32 containerCount = 0;
+            // workspaces waiting to be laid out in the next frame
+            std::bitset<WORKSPACES> pendingReflows;
+            // storage of all containers, anything outliving a window should keep a handle instead of a pointer
+            SlabPool<Container> m_containerPool;
+            // geometry configured but not yet applied
+            LayoutTransaction m_layoutTransaction{m_containerPool};
+            // amount of nodes(roots included) in every workspace tree, kept up to date by tree mutations
+            std::vector<UInt32> workspaceNodeCounts;
             // all windows present(not only tiled ones)
             std::vector<ToplevelRole*> windows = {};
+            // see `stateGeneration`
+            std::atomic<UInt64> m_stateGeneration{1};
+            // walk every tree with `validateWorkspaceIds` before each reflow(`TILEY_VALIDATE_LAYOUT=1`), off by default:
+            // the walk costs more than the reflow itself
+            bool m_validateLayout = validateLayoutRequested();
+            static bool validateLayoutRequested();
 
             /* resizing parameters */
             LPointF initialCursorPos;
             double initialHorizontalRatio;
             double initialVerticalRatio;
-            Container* resizingHorizontalTarget;
-            Container* resizingVerticalTarget;
+            LayoutNode* resizingHorizontalTarget = nullptr;
+            LayoutNode* resizingVerticalTarget = nullptr;
 
             // workspace switching animation
             std::unique_ptr<LAnimation> m_workspaceSwitchAnimation;
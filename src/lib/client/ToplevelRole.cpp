@@ -8,6 +8,7 @@
 #include "LToplevelRole.h"
 #include "src/lib/TileyServer.hpp"
 #include "src/lib/TileyWindowStateManager.hpp"
+#include "src/lib/input/SurfaceIndex.hpp"
 #include "src/lib/core/UserAction.hpp"
 
 using namespace tiley;
@@ -75,6 +76,15 @@ void ToplevelRole::printWindowGeometryInfo(LToplevelRole* toplevel){
 void ToplevelRole::atomsChanged(LBitset<AtomChanges> changes, const Atoms &prev){
     //LLog::log("[atomsChanged]: window properties changed");
     LToplevelRole::atomsChanged(changes, prev);
+    // title, app id, size and states are reported over IPC
+    TileyWindowStateManager::getInstance().markStateChanged();
+    // the window geometry offsets the surface
+    SurfaceIndex::invalidateAll();
+
+    // the client may have acked the size of a pending layout change
+    if(container){
+        TileyWindowStateManager::getInstance().layoutTransaction().windowCommitted(this);
+    }
 };
 
 // client triggers configuration and we need to respond with proper settings
@@ -10,6 +10,7 @@
 
 #include "src/lib/Utils.hpp"
 #include "src/lib/output/Output.hpp"
+#include "src/test/TraceZone.hpp"
 
 using namespace tiley;
 
@@ -143,6 +144,7 @@ void WallpaperManager::selectAndSetNewWallpaper() {
 }
 
 void WallpaperManager::applyToOutput(Louvre::LOutput* _output) {
+    TILEY_TRACE_ZONE("WallpaperManager::applyToOutput");
 
     LLog::log("[WallpaperManager::applyToOutput]: attemp to apply wallpaper to output");
 
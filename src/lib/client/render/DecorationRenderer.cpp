@@ -0,0 +1,228 @@
+#include "DecorationRenderer.hpp"
+
+#include "src/lib/TileyServer.hpp"
+#include "src/test/TraceZone.hpp"
+
+#include <LFramebuffer.h>
+#include <LLog.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace tiley;
+using namespace Louvre;
+
+DecorationRenderer::DecorationRenderer() {
+    if (const char* modeEnv = getenv("TILEY_DECORATION_MODE")) {
+        if (strcmp(modeEnv, "full-sdf") == 0) {
+            m_mode = Mode::FULL_SDF;
+        } else if (strcmp(modeEnv, "sdf-ring") != 0) {
+            LLog::warning("[DecorationRenderer]: unknown TILEY_DECORATION_MODE: %s, using sdf-ring", modeEnv);
+        }
+    }
+}
+
+DecorationRenderer::~DecorationRenderer() {
+    if (m_vbo != 0) {
+        glDeleteBuffers(1, &m_vbo);
+    }
+}
+
+bool DecorationRenderer::add(const LFramebuffer* framebuffer, GLuint texture, const LRect& rect,
+                             const LRegion& region, const LRegion* opaque, const DecorationStyle& style) {
+    if (m_framebuffer && m_framebuffer != framebuffer) {
+        return false;
+    }
+
+    if (rect.w() <= 0 || rect.h() <= 0) {
+        return true;
+    }
+
+    m_framebuffer = framebuffer;
+    const Float32 scale = framebuffer->scale();
+
+    LRegion damaged = region;
+    damaged.clip(rect);
+    m_queued.addRegion(damaged);
+
+    // outside of this margin pixels are neither rounded, bordered nor anti-aliased(1.5 physical px, see the shader)
+    const Int32 margin = (Int32)std::ceil(std::max(style.radius, std::max(style.borderWidth, 1.5f / scale)));
+    const LRect inner(rect.x() + margin, rect.y() + margin, rect.w() - 2 * margin, rect.h() - 2 * margin);
+
+    const WindowInteriorShader* interiorShader = TileyServer::getInstance().windowInteriorShader();
+    if (m_mode == Mode::FULL_SDF || !interiorShader || !interiorShader->valid() || inner.w() <= 0 || inner.h() <= 0) {
+        append(EDGE, texture, damaged, rect, style, scale);
+        return true;
+    }
+
+    LRegion edge = damaged;
+    edge.subtractRect(inner);
+    append(EDGE, texture, edge, rect, style, scale);
+
+    LRegion interior = damaged;
+    interior.clip(inner);
+    if (opaque) {
+        LRegion opaqueInterior = interior;
+        opaqueInterior.intersectRegion(*opaque);
+        append(OPAQUE_INTERIOR, texture, opaqueInterior, rect, style, scale);
+        interior.subtractRegion(*opaque);
+    }
+    append(TRANSLUCENT_INTERIOR, texture, interior, rect, style, scale);
+
+    return true;
+}
+
+void DecorationRenderer::append(Pass pass, GLuint texture, const LRegion& region, const LRect& rect,
+                                const DecorationStyle& style, Float32 scale) {
+    const Float32 halfW = rect.w() * 0.5f;
+    const Float32 halfH = rect.h() * 0.5f;
+
+    const auto vertex = [&](Int32 x, Int32 y) {
+        const Float32 localX = x - rect.x();
+        const Float32 localY = y - rect.y();
+        m_vertices.insert(m_vertices.end(), {
+            (GLfloat)x, (GLfloat)y,
+            localX / rect.w(), localY / rect.h(),
+            (localX - halfW) * scale, (localY - halfH) * scale,
+            halfW * scale, halfH * scale, style.radius * scale, style.borderWidth * scale,
+            style.borderColor.r, style.borderColor.g, style.borderColor.b
+        });
+    };
+
+    const GLint first = m_vertices.size() / VERTEX_FLOATS;
+
+    // every box becomes two triangles, no scissor needed
+    Int32 n;
+    const LBox* boxes = region.boxes(&n);
+    for (Int32 i = 0; i < n; i++) {
+        const LBox& box = boxes[i];
+        vertex(box.x1, box.y1); vertex(box.x2, box.y1); vertex(box.x2, box.y2);
+        vertex(box.x2, box.y2); vertex(box.x1, box.y2); vertex(box.x1, box.y1);
+    }
+
+    const GLsizei count = m_vertices.size() / VERTEX_FLOATS - first;
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<Draw>& draws = m_draws[pass];
+    if (!draws.empty() && draws.back().texture == texture && draws.back().first + draws.back().count == first) {
+        draws.back().count += count;
+    } else {
+        draws.push_back({texture, first, count});
+    }
+}
+
+void DecorationRenderer::flush(LPainter* painter, GLRenderState& state) {
+    if (empty()) {
+        return;
+    }
+
+    TILEY_TRACE_ZONE("DecorationRenderer::flush");
+    TileyServer& server = TileyServer::getInstance();
+    const LFramebuffer* framebuffer = painter->boundFramebuffer();
+    if (!server.roundedCornerShader() || !server.roundedCornerShader()->valid() || !framebuffer || framebuffer != m_framebuffer) {
+        LLog::warning("[DecorationRenderer::flush]: no usable shader or the framebuffer changed, dropping queued windows");
+        clear();
+        return;
+    }
+
+    if (m_vbo == 0) {
+        glGenBuffers(1, &m_vbo);
+    }
+
+    // LPainter feeds client side arrays and got the context back after the last flush, vertex pointers have to be
+    // specified again for the first program
+    state.bindArrayBuffer(m_vbo);
+    GLuint pointersProgram = 0;
+    // a new store every frame, the driver does not have to wait for the previous draws reading the old one
+    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(GLfloat), m_vertices.data(), GL_STREAM_DRAW);
+
+    // the framebuffer covers `rect` of the global logical space, y grows downwards
+    const LRect& rect = framebuffer->rect();
+    RoundedCornerParams params;
+    params.transform = glm::ortho((float)rect.x(), (float)(rect.x() + rect.w()),
+                                  (float)(rect.y() + rect.h()), (float)rect.y(), -1.0f, 1.0f);
+    params.textureUnit = 0;
+
+    state.activeTexture(GL_TEXTURE0);
+    state.setViewport(0, 0, framebuffer->sizeB().w(), framebuffer->sizeB().h());
+    state.setScissorTest(false);
+    state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    drawPass(OPAQUE_INTERIOR, params, state, pointersProgram);
+    drawPass(TRANSLUCENT_INTERIOR, params, state, pointersProgram);
+    drawPass(EDGE, params, state, pointersProgram);
+
+    state.handBack(painter);
+    clear();
+}
+
+void DecorationRenderer::drawPass(Pass pass, const RoundedCornerParams& params, GLRenderState& state, GLuint& pointersProgram) {
+    const std::vector<Draw>& draws = m_draws[pass];
+    if (draws.empty()) {
+        return;
+    }
+
+    TileyServer& server = TileyServer::getInstance();
+    const GLsizei stride = VERTEX_FLOATS * sizeof(GLfloat);
+
+    if (pass == EDGE) {
+        RoundedCornerShader* shader = server.roundedCornerShader();
+        state.useProgram(shader->id());
+        if (pointersProgram != shader->id()) {
+            glVertexAttribPointer(shader->positionAttribute(), 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+            glVertexAttribPointer(shader->texCoordAttribute(), 2, GL_FLOAT, GL_FALSE, stride, (void*)(2 * sizeof(GLfloat)));
+            glVertexAttribPointer(shader->localAttribute(), 2, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(GLfloat)));
+            glVertexAttribPointer(shader->shapeAttribute(), 4, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(GLfloat)));
+            glVertexAttribPointer(shader->borderColorAttribute(), 3, GL_FLOAT, GL_FALSE, stride, (void*)(10 * sizeof(GLfloat)));
+            pointersProgram = shader->id();
+        }
+        state.enableVertexAttribs((1u << shader->positionAttribute()) | (1u << shader->texCoordAttribute()) |
+                                  (1u << shader->localAttribute()) | (1u << shader->shapeAttribute()) |
+                                  (1u << shader->borderColorAttribute()));
+        shader->apply(params);
+    } else {
+        // only queued when the interior program is available
+        WindowInteriorShader* shader = server.windowInteriorShader();
+        state.useProgram(shader->id());
+        if (pointersProgram != shader->id()) {
+            glVertexAttribPointer(shader->positionAttribute(), 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+            glVertexAttribPointer(shader->texCoordAttribute(), 2, GL_FLOAT, GL_FALSE, stride, (void*)(2 * sizeof(GLfloat)));
+            pointersProgram = shader->id();
+        }
+        state.enableVertexAttribs((1u << shader->positionAttribute()) | (1u << shader->texCoordAttribute()));
+        shader->apply(params);
+    }
+
+    // opaque interiors replace what is below, everything else is blended
+    state.setBlend(pass != OPAQUE_INTERIOR);
+
+    for (const Draw& draw : draws) {
+        state.bindTexture2D(draw.texture);
+        glDrawArrays(GL_TRIANGLES, draw.first, draw.count);
+    }
+}
+
+void DecorationRenderer::clear() {
+    m_vertices.clear();
+    for (auto& draws : m_draws) {
+        draws.clear();
+    }
+    m_framebuffer = nullptr;
+    m_queued.clear();
+}
+
+bool DecorationRenderer::overlaps(const LRegion& region) const {
+    if (m_queued.empty()) {
+        return false;
+    }
+    LRegion intersection = m_queued;
+    intersection.intersectRegion(region);
+    return !intersection.empty();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "src/lib/client/render/GLRenderState.hpp"
+#include "src/lib/client/render/RoundedCornerShader.hpp"
+
+#include <GLES2/gl2.h>
+#include <LFramebuffer.h>
+#include <LNamespaces.h>
+#include <LPainter.h>
+#include <LRect.h>
+#include <LRegion.h>
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <vector>
+
+namespace tiley {
+
+    // Look of a tiled window(logical px)
+    struct DecorationStyle {
+        Louvre::Float32 radius = 8.f;
+        Louvre::Float32 borderWidth = 2.f;
+        glm::vec3 borderColor { 1.f, 1.f, 1.f };
+    };
+
+    // Draws rounded corner windows in batches. Windows are queued while the scene is painted and drawn together:
+    // the damaged part of every window becomes triangles in one dynamic vertex buffer, uploaded once, and consecutive
+    // windows sharing a texture are drawn by a single call. Window parameters are vertex attributes, so only the
+    // texture changes between draws.
+    //
+    // By default only a ring along the window edges, as wide as the corner radius or the border, runs the rounded
+    // corner SDF. The rest of the window is a plain textured quad, drawn without blending where the client declared
+    // it opaque. Set TILEY_DECORATION_MODE=full-sdf to run the SDF over whole windows instead.
+    //
+    // One renderer per GL context(i.e. per output), its vertex buffer is not shared between render threads.
+    class DecorationRenderer {
+        public:
+            enum class Mode {
+                SDF_RING,   // SDF along the edges, plain interior
+                FULL_SDF,   // SDF over the whole window
+            };
+
+            DecorationRenderer();
+            // the context of the renderer must be current
+            ~DecorationRenderer();
+
+            DecorationRenderer(const DecorationRenderer&) = delete;
+            DecorationRenderer& operator=(const DecorationRenderer&) = delete;
+
+            // add: queue a window showing `texture` at `rect`, limited to `region`, to be drawn into `framebuffer`.
+            // `opaque` is the part of the window the client declared opaque, nullptr if unknown.
+            // Coordinates are global logical ones. Returns false if queued windows target another framebuffer.
+            bool add(const Louvre::LFramebuffer* framebuffer, GLuint texture, const Louvre::LRect& rect,
+                     const Louvre::LRegion& region, const Louvre::LRegion* opaque, const DecorationStyle& style);
+            // flush: draw queued windows into their framebuffer, which must be the one bound to `painter`,
+            // then give the context back to the painter
+            void flush(Louvre::LPainter* painter, GLRenderState& state);
+            // clear: drop queued windows without drawing them
+            void clear();
+            // overlaps: whether `region` intersects queued windows. Passes reorder draws, so overlapping windows(e.g.
+            // translucent parts of stacked windows) must not be queued together: flush before adding such a window.
+            bool overlaps(const Louvre::LRegion& region) const;
+
+            bool empty() const;
+            inline Mode mode() const { return m_mode; }
+
+        private:
+            // aPos(2) aTexCoord(2) aLocal(2) aShape(4) aBorderColor(3)
+            static constexpr GLsizei VERTEX_FLOATS = 13;
+
+            // draw passes, their regions never overlap so the order does not matter
+            enum Pass {
+                OPAQUE_INTERIOR,        // plain, no blending
+                TRANSLUCENT_INTERIOR,   // plain, blending
+                EDGE,                   // SDF, blending
+                PASS_COUNT
+            };
+
+            // a range of vertices drawn with the same texture
+            struct Draw {
+                GLuint texture;
+                GLint first;
+                GLsizei count;
+            };
+
+            // append: turn the boxes of `region` into triangles of `pass`
+            void append(Pass pass, GLuint texture, const Louvre::LRegion& region, const Louvre::LRect& rect,
+                        const DecorationStyle& style, Louvre::Float32 scale);
+            // drawPass: draw the ranges of `pass`. Programs locate attributes differently, so vertex pointers are
+            // specified again unless they were set for the program of the pass(`pointersProgram`).
+            void drawPass(Pass pass, const RoundedCornerParams& params, GLRenderState& state, GLuint& pointersProgram);
+
+            Mode m_mode = Mode::SDF_RING;
+            std::vector<GLfloat> m_vertices;
+            std::array<std::vector<Draw>, PASS_COUNT> m_draws;
+            const Louvre::LFramebuffer* m_framebuffer = nullptr;
+            // everything queued, for `overlaps`
+            Louvre::LRegion m_queued;
+            GLuint m_vbo = 0;
+    };
+}
@@ -0,0 +1,118 @@
+#include "GLRenderState.hpp"
+
+using namespace tiley;
+using namespace Louvre;
+
+void GLRenderState::invalidate() {
+    *this = GLRenderState();
+}
+
+void GLRenderState::handBack(LPainter* painter) {
+    // LPainter feeds client side vertex arrays, draws opaque content without blending and expects no scissor
+    enableVertexAttribs(0);
+    bindArrayBuffer(0);
+    setScissorTest(false);
+    setBlend(false);
+    painter->bindProgram();
+
+    // from here on LPainter binds its own program and textures, and may toggle blending, scissor and viewport
+    m_program = UNKNOWN_NAME;
+    m_arrayBuffer = UNKNOWN_NAME;
+    m_texture2D = UNKNOWN_NAME;
+    m_activeTexture = 0;
+    m_blend = Toggle::Unknown;
+    m_blendSrc = m_blendDst = 0;
+    m_scissorTest = Toggle::Unknown;
+    m_viewport[0] = m_viewport[1] = m_viewport[2] = m_viewport[3] = -1;
+}
+
+void GLRenderState::useProgram(GLuint program) {
+    if (m_program != program) {
+        glUseProgram(program);
+        m_program = program;
+    }
+}
+
+bool GLRenderState::bindArrayBuffer(GLuint buffer) {
+    if (m_arrayBuffer == buffer) {
+        return false;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    m_arrayBuffer = buffer;
+    return true;
+}
+
+void GLRenderState::bindElementBuffer(GLuint buffer) {
+    if (m_elementBuffer != buffer) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        m_elementBuffer = buffer;
+    }
+}
+
+void GLRenderState::activeTexture(GLenum unit) {
+    if (m_activeTexture != unit) {
+        glActiveTexture(unit);
+        m_activeTexture = unit;
+        // binding points are per unit
+        m_texture2D = UNKNOWN_NAME;
+    }
+}
+
+void GLRenderState::bindTexture2D(GLuint texture) {
+    if (m_texture2D != texture) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        m_texture2D = texture;
+    }
+}
+
+void GLRenderState::enableVertexAttribs(UInt32 mask) {
+    const UInt32 changed = m_enabledAttribs ^ mask;
+    if (!changed) {
+        return;
+    }
+    for (UInt32 location = 0; location < 32; location++) {
+        const UInt32 bit = 1u << location;
+        if (changed & bit) {
+            if (mask & bit) {
+                glEnableVertexAttribArray(location);
+            } else {
+                glDisableVertexAttribArray(location);
+            }
+        }
+    }
+    m_enabledAttribs = mask;
+}
+
+void GLRenderState::setBlend(bool enabled) {
+    const Toggle target = enabled ? Toggle::On : Toggle::Off;
+    if (m_blend != target) {
+        enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+        m_blend = target;
+    }
+}
+
+void GLRenderState::setBlendFunc(GLenum sfactor, GLenum dfactor) {
+    if (m_blendSrc != sfactor || m_blendDst != dfactor) {
+        glBlendFunc(sfactor, dfactor);
+        m_blendSrc = sfactor;
+        m_blendDst = dfactor;
+    }
+}
+
+void GLRenderState::setScissorTest(bool enabled) {
+    const Toggle target = enabled ? Toggle::On : Toggle::Off;
+    if (m_scissorTest != target) {
+        enabled ? glEnable(GL_SCISSOR_TEST) : glDisable(GL_SCISSOR_TEST);
+        m_scissorTest = target;
+    }
+}
+
+void GLRenderState::setViewport(GLint x, GLint y, GLsizei w, GLsizei h) {
+    if (m_viewport[0] != x || m_viewport[1] != y || m_viewport[2] != w || m_viewport[3] != h) {
+        glViewport(x, y, w, h);
+        m_viewport[0] = x;
+        m_viewport[1] = y;
+        m_viewport[2] = w;
+        m_viewport[3] = h;
+    }
+}
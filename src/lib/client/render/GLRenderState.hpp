@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <LNamespaces.h>
+#include <LPainter.h>
+
+namespace tiley {
+
+    // Shadow of the GL state touched by tiley's custom draws in one GL context(i.e. one output).
+    // Setters only reach GL when the value differs from the shadow, nothing is ever read back with glGet*.
+    //
+    // LPainter owns the context between our draws and expects its program back(`LPainter::bindProgram`), so `handBack`
+    // restores what LPainter relies on and marks everything it may change as unknown. State LPainter never touches
+    // (the element buffer) survives across draws of the same frame, the rest is only set again when actually needed.
+    class GLRenderState {
+        public:
+            // invalidate: forget everything, e.g. at the beginning of a frame or after the context was recreated
+            void invalidate();
+            // handBack: give the context back to `painter` after a custom draw
+            void handBack(Louvre::LPainter* painter);
+
+            void useProgram(GLuint program);
+            // bindArrayBuffer: returns true if the binding changed, vertex attrib pointers then have to be specified again
+            bool bindArrayBuffer(GLuint buffer);
+            void bindElementBuffer(GLuint buffer);
+            void activeTexture(GLenum unit);
+            void bindTexture2D(GLuint texture);
+            // enableVertexAttribs: enable exactly the attributes in `mask`(bit i for location i) among the ones enabled by us
+            void enableVertexAttribs(Louvre::UInt32 mask);
+            void setBlend(bool enabled);
+            void setBlendFunc(GLenum sfactor, GLenum dfactor);
+            void setScissorTest(bool enabled);
+            void setViewport(GLint x, GLint y, GLsizei w, GLsizei h);
+
+        private:
+            // a tri-state flag: unknown until we set it
+            enum class Toggle : Louvre::UInt8 { Unknown, Off, On };
+
+            static constexpr GLuint UNKNOWN_NAME = ~0u;
+
+            GLuint m_program = UNKNOWN_NAME;
+            GLuint m_arrayBuffer = UNKNOWN_NAME;
+            GLuint m_elementBuffer = UNKNOWN_NAME;
+            GLenum m_activeTexture = 0;
+            GLuint m_texture2D = UNKNOWN_NAME;
+            Louvre::UInt32 m_enabledAttribs = 0;
+            Toggle m_blend = Toggle::Unknown;
+            GLenum m_blendSrc = 0, m_blendDst = 0;
+            Toggle m_scissorTest = Toggle::Unknown;
+            GLint m_viewport[4] { -1, -1, -1, -1 };
+    };
+}
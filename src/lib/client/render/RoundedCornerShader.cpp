@@ -0,0 +1,26 @@
+#include "RoundedCornerShader.hpp"
+
+#include <LLog.h>
+
+using namespace tiley;
+using namespace Louvre;
+
+void RoundedCornerShader::linked() {
+    m_aPos = attributeLocation("aPos");
+    m_aTexCoord = attributeLocation("aTexCoord");
+    m_aLocal = attributeLocation("aLocal");
+    m_aShape = attributeLocation("aShape");
+    m_aBorderColor = attributeLocation("aBorderColor");
+
+    m_uTransform = uniformLocation("u_transform");
+    m_uTexture = uniformLocation("u_texture");
+
+    if (!valid() || m_uTransform < 0 || m_uTexture < 0) {
+        LLog::warning("[RoundedCornerShader]: some inputs of the rounded corner shader are inactive, windows may not be drawn correctly");
+    }
+}
+
+void RoundedCornerShader::apply(const RoundedCornerParams& params) {
+    setUniform(m_uTransform, params.transform);
+    setUniform(m_uTexture, params.textureUnit);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "src/lib/client/render/Shader.hpp"
+
+#include <LNamespaces.h>
+#include <glm/mat4x4.hpp>
+
+namespace tiley {
+
+    // Uniforms of rounded_corners.{vert,frag}, shared by every window of a batch.
+    // Per window values(size, radius, border) are vertex attributes, see `DecorationRenderer`.
+    struct RoundedCornerParams {
+        // framebuffer logical coordinates to clip space
+        glm::mat4 transform { 1.f };
+        // texture unit of the window content
+        GLint textureUnit = 0;
+    };
+
+    // The window rounded corner program, locations are resolved once when linked
+    class RoundedCornerShader final : public Shader {
+        public:
+            // apply: upload `params`, unchanged values are not uploaded again. The program must be in use.
+            void apply(const RoundedCornerParams& params);
+
+            inline GLint positionAttribute() const { return m_aPos; }
+            inline GLint texCoordAttribute() const { return m_aTexCoord; }
+            inline GLint localAttribute() const { return m_aLocal; }
+            inline GLint shapeAttribute() const { return m_aShape; }
+            inline GLint borderColorAttribute() const { return m_aBorderColor; }
+
+            // valid: every attribute is active, otherwise the program can not be fed
+            inline bool valid() const {
+                return m_aPos >= 0 && m_aTexCoord >= 0 && m_aLocal >= 0 && m_aShape >= 0 && m_aBorderColor >= 0;
+            }
+
+        protected:
+            void linked() override;
+
+        private:
+            GLint m_aPos = -1;
+            GLint m_aTexCoord = -1;
+            GLint m_aLocal = -1;
+            GLint m_aShape = -1;
+            GLint m_aBorderColor = -1;
+
+            GLint m_uTransform = -1;
+            GLint m_uTexture = -1;
+    };
+}
@@ -6,6 +6,9 @@
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 using namespace tiley;
 using namespace Louvre;
 
@@ -44,6 +47,69 @@ bool Shader::link(GLuint vertexShader, GLuint fragmentShader) {
     glDetachShader(m_programID, vertexShader);
     glDetachShader(m_programID, fragmentShader);
 
+    resolveLocations();
+    linked();
+
+    return true;
+}
+
+void Shader::resolveLocations() {
+    m_uniformLocations.clear();
+    m_attributeLocations.clear();
+    m_uniformValues.clear();
+
+    GLint count = 0, maxLength = 0;
+    GLint maxLocation = -1;
+
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(std::max(maxLength, 1));
+
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(m_programID, i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+        GLint location = glGetUniformLocation(m_programID, name.data());
+        m_uniformLocations[name.data()] = location;
+        maxLocation = std::max(maxLocation, location);
+    }
+
+    m_uniformValues.resize(maxLocation + 1);
+
+    glGetProgramiv(m_programID, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(m_programID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    name.assign(std::max(maxLength, 1), '\0');
+
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(m_programID, i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+        m_attributeLocations[name.data()] = glGetAttribLocation(m_programID, name.data());
+    }
+}
+
+GLint Shader::uniformLocation(const char* name) const {
+    auto it = m_uniformLocations.find(name);
+    return it == m_uniformLocations.end() ? -1 : it->second;
+}
+
+GLint Shader::attributeLocation(const char* name) const {
+    auto it = m_attributeLocations.find(name);
+    return it == m_attributeLocations.end() ? -1 : it->second;
+}
+
+bool Shader::changed(GLint location, const GLfloat* data, std::size_t count) {
+    if (location < 0 || location >= (GLint)m_uniformValues.size()) {
+        return location >= 0;
+    }
+
+    UniformValue& cached = m_uniformValues[location];
+    if (cached.valid && std::memcmp(cached.data.data(), data, count * sizeof(GLfloat)) == 0) {
+        return false;
+    }
+
+    std::memcpy(cached.data.data(), data, count * sizeof(GLfloat));
+    cached.valid = true;
     return true;
 }
 
@@ -52,23 +118,55 @@ void Shader::use() const {
 }
 
 // Uniform set toolkit
-// TODO: STL
+void Shader::setUniform(GLint location, int value) {
+    GLfloat data;
+    std::memcpy(&data, &value, sizeof(data));
+    if (changed(location, &data, 1)) {
+        glUniform1i(location, value);
+    }
+}
+
+void Shader::setUniform(GLint location, float value) {
+    if (changed(location, &value, 1)) {
+        glUniform1f(location, value);
+    }
+}
+
+void Shader::setUniform(GLint location, const LPointF& value) {
+    const GLfloat data[2] { value.x(), value.y() };
+    if (changed(location, data, 2)) {
+        glUniform2f(location, data[0], data[1]);
+    }
+}
+
+void Shader::setUniform(GLint location, const glm::vec3& vec3) {
+    if (changed(location, glm::value_ptr(vec3), 3)) {
+        glUniform3f(location, vec3[0], vec3[1], vec3[2]);
+    }
+}
+
+void Shader::setUniform(GLint location, const glm::mat4& mat4) {
+    if (changed(location, glm::value_ptr(mat4), 16)) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat4));
+    }
+}
+
 void Shader::setUniform(const char* name, int value) {
-    glUniform1i(glGetUniformLocation(m_programID, name), value);
+    setUniform(uniformLocation(name), value);
 }
 
 void Shader::setUniform(const char* name, float value) {
-    glUniform1f(glGetUniformLocation(m_programID, name), value);
+    setUniform(uniformLocation(name), value);
 }
 
 void Shader::setUniform(const char* name, const LPointF& value) {
-    glUniform2f(glGetUniformLocation(m_programID, name), value.x(), value.y());
+    setUniform(uniformLocation(name), value);
 }
 
 void Shader::setUniform(const char* name, const glm::vec3& vec3){
-    glUniform3f(glGetUniformLocation(m_programID, name), vec3[0], vec3[1], vec3[2]);
+    setUniform(uniformLocation(name), vec3);
 }
 
 void Shader::setUniform(const char* name, const glm::mat4& mat4) {
-    glUniformMatrix4fv(glGetUniformLocation(m_programID, name), 1, GL_FALSE, glm::value_ptr(mat4));
+    setUniform(uniformLocation(name), mat4);
 }
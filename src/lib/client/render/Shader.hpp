@@ -5,13 +5,38 @@
 #include <LPoint.h>
 #include <glm/fwd.hpp>
 #include <glm/vec3.hpp>
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace tiley {
     class Shader {  
         public:
             Shader();
-            ~Shader();
+            virtual ~Shader();
+
+            Shader(const Shader&) = delete;
+            Shader& operator=(const Shader&) = delete;
+
+            // link: link the program and resolve locations of all active uniforms and attributes
             bool link(GLuint vertexShader, GLuint fragmentShader);
             void use() const;
+
+            // uniformLocation/attributeLocation: cached locations, -1 if `name` is not active in the program
+            GLint uniformLocation(const char* name) const;
+            GLint attributeLocation(const char* name) const;
+
+            // setUniform: location based setters, glUniform* is skipped when the value did not change since the last call.
+            // The program must be in use.
+            void setUniform(GLint location, int value);
+            void setUniform(GLint location, float value);
+            void setUniform(GLint location, const Louvre::LPointF& value);
+            void setUniform(GLint location, const glm::vec3& vec3);
+            void setUniform(GLint location, const glm::mat4& mat4);
+
+            // name based setters, prefer resolving locations once
             void setUniform(const char* name, int value);
             void setUniform(const char* name, float value);
             void setUniform(const char* name, const Louvre::LPointF& value);
@@ -20,7 +45,26 @@ namespace tiley {
 
             GLuint id() const {return m_programID;}
 
+        protected:
+            // linked: called after a successful link, subclasses resolve the locations they need here
+            virtual void linked(){}
+
         private:
             GLuint m_programID { 0 };
+
+            std::unordered_map<std::string, GLint> m_uniformLocations;
+            std::unordered_map<std::string, GLint> m_attributeLocations;
+
+            // last value uploaded to every uniform location
+            struct UniformValue{
+                std::array<GLfloat, 16> data;
+                bool valid = false;
+            };
+            std::vector<UniformValue> m_uniformValues;
+
+            // resolveLocations: fill location tables from the active uniforms/attributes of the program
+            void resolveLocations();
+            // changed: compare `data` with the cached value of `location` and store it, false if nothing to upload
+            bool changed(GLint location, const GLfloat* data, std::size_t count);
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,23 @@
+#include "WindowInteriorShader.hpp"
+
+#include <LLog.h>
+
+using namespace tiley;
+using namespace Louvre;
+
+void WindowInteriorShader::linked() {
+    m_aPos = attributeLocation("aPos");
+    m_aTexCoord = attributeLocation("aTexCoord");
+
+    m_uTransform = uniformLocation("u_transform");
+    m_uTexture = uniformLocation("u_texture");
+
+    if (!valid() || m_uTransform < 0 || m_uTexture < 0) {
+        LLog::warning("[WindowInteriorShader]: some inputs of the window interior shader are inactive, windows may not be drawn correctly");
+    }
+}
+
+void WindowInteriorShader::apply(const RoundedCornerParams& params) {
+    setUniform(m_uTransform, params.transform);
+    setUniform(m_uTexture, params.textureUnit);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "src/lib/client/render/RoundedCornerShader.hpp"
+#include "src/lib/client/render/Shader.hpp"
+
+namespace tiley {
+
+    // Plain textured program(rounded_corners.vert + window_interior.frag) for the part of a window which needs no
+    // corner or border math. It takes the same uniforms as `RoundedCornerShader`.
+    class WindowInteriorShader final : public Shader {
+        public:
+            // apply: upload `params`, unchanged values are not uploaded again. The program must be in use.
+            void apply(const RoundedCornerParams& params);
+
+            inline GLint positionAttribute() const { return m_aPos; }
+            inline GLint texCoordAttribute() const { return m_aTexCoord; }
+
+            inline bool valid() const { return m_aPos >= 0 && m_aTexCoord >= 0; }
+
+        protected:
+            void linked() override;
+
+        private:
+            GLint m_aPos = -1;
+            GLint m_aTexCoord = -1;
+
+            GLint m_uTransform = -1;
+            GLint m_uTexture = -1;
+    };
+}
@@ -0,0 +1,14 @@
+#include "DecorationFlushView.hpp"
+
+#include "src/lib/TileyServer.hpp"
+
+#include <LPainter.h>
+#include <private/LPainterPrivate.h>
+
+using namespace tiley;
+
+void DecorationFlushView::paintEvent(const PaintEventParams& params) noexcept{
+    // nothing of its own to draw
+    TileyServer::OutputRenderResources& resources = TileyServer::getInstance().renderResources(params.painter->imp()->output);
+    resources.decorations.flush(params.painter, resources.state);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <LSolidColorView.h>
+
+using namespace Louvre;
+
+namespace tiley{
+    // Invisible view placed between the application and popup layers of an output.
+    // Louvre paints translucent content back to front, so when it reaches this view every window below has been
+    // queued to the output's `DecorationRenderer`: draw them before popups and overlays are painted on top.
+    class DecorationFlushView final : public LSolidColorView{
+        public:
+            // semi-transparent so the scene never considers anything below it occluded
+            DecorationFlushView() noexcept : LSolidColorView({0.f, 0.f, 0.f}, 0.5f){}
+
+            void paintEvent(const PaintEventParams& params) noexcept override;
+    };
+}
@@ -2,19 +2,20 @@
 
 #include "src/lib/TileyServer.hpp"
 #include "src/lib/types.hpp"
+#include "src/test/TraceZone.hpp"
 
 #include <GLES2/gl2.h>
 #include <algorithm>
+#include <cmath>
 #include <glm/fwd.hpp>
 #define GLM_FORCE_RADIANS // 确保 glm 使用弧度,与 OpenGL 标准一致
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp> // 包含 glm::translate, glm::rotate, glm::scale
-#include <glm/gtc/type_ptr.hpp>         // 包含 glm::value_ptr
 
 #include <LPointerButtonEvent.h>
 #include <LLog.h>
 #include <LNamespaces.h>
 #include <LPainter.h>
+#include <LFramebuffer.h>
 #include <private/LPainterPrivate.h>
 
 #include <LToplevelMoveSession.h>
@@ -23,6 +24,12 @@
 
 using namespace tiley;
 
+// 窗口圆角半径和边框(逻辑像素, 绘制时根据缩放比例放大)
+// TODO: 圆角半径, 可以从配置文件读取
+static const DecorationStyle WINDOW_STYLE { 8.f, 2.f, glm::vec3(1.0f, 1.0f, 1.0f) };
+// 抗锯齿边缘的宽度(逻辑像素), 着色器在距离边缘1.5个物理像素内逐渐透明
+static constexpr Int32 ANTI_ALIAS_WIDTH = 2;
+
 // 必须在SurfaceView的构造函数中就初始化对应的父亲层级关系
 // 由于我们不知道surface何时提交到合成器, 如果在mappingChanged中才现场setParent的话太晚, 因为orderChanged比mappingChanged更早触发
 // 在orderChanged里面又要对view进行排序。所以我们必须在orderChanged前(甚至所有surface相关提交操作之前)就把父级关系设置好
@@ -32,10 +39,10 @@ LSurfaceView((LSurface*)surface, &TileyServer::getInstance().layers()[APPLICATIO
 SurfaceView::~SurfaceView() noexcept{}
 
 void SurfaceView::paintEvent(const PaintEventParams& params) noexcept{
-    
+   TILEY_TRACE_ZONE("SurfaceView::paintEvent");
+
    // LSurfaceView::paintEvent(params);
    // return;
-   tiley::setPerfmonPath("surfaceview", "/home/zero/tiley/src/lib/test/test_performance.txt");
    // 如果自己是正在移动的窗口的SurfaceView
    auto moveSessions = seat()->toplevelMoveSessions();
     auto iterator = std::find_if(moveSessions.begin(), moveSessions.end(), [this](auto session){
@@ -55,144 +62,87 @@ void SurfaceView::paintEvent(const PaintEventParams& params) noexcept{
     /*LSurfaceView::paintEvent(params);
     return;
     */
-  
+
+    TileyServer &server = TileyServer::getInstance();
+    LOutput* output = params.painter->imp()->output;
+    TileyServer::OutputRenderResources &resources = server.renderResources(output);
+    DecorationRenderer &decorations = resources.decorations;
+    RoundedCornerShader *shader = server.roundedCornerShader();
+    const LFramebuffer *framebuffer = params.painter->boundFramebuffer();
+
+    // 窗口不会立即绘制, 而是先交给该屏幕的DecorationRenderer, 之后一次性批量绘制
+    // 不透明阶段各窗口的区域互不重叠, 所以顺序无关; 但在画其他内容之前, 必须先把攒下的窗口画出来
+    const auto paintDefault = [&](){
+        decorations.flush(params.painter, resources.state);
+        LSurfaceView::paintEvent(params);
+    };
+
     // 如果不是窗口, 使用默认绘制方法
     if(surface() && !surface()->toplevel()){
-        // performanceMonitor.renderStart();  // 开始记录渲染时间
-        LSurfaceView::paintEvent(params);
-       // performanceMonitor.renderEnd();  // 结束记录渲染时间
-    //performanceMonitor.recordFrame(); // 记录当前帧的数据
+        paintDefault();
         return;
     }
 
-    TileyServer &server = TileyServer::getInstance();
-    Shader *shader = server.roundedCornerShader();
-    // 获取需要重绘的区域
-    LRegion *region = params.region;
-    LOutput* output = params.painter->imp()->output;
-
     // 如果没有着色器或者窗口没有纹理, 也使用默认绘制方法
-    if (!shader || !surface() || !surface()->texture() || region->empty()) {
+    if (!shader || !shader->valid() || !surface() || !surface()->texture() || !framebuffer) {
         LLog::warning("当前surface不满足自定义绘制条件, 使用窗口默认绘制方法");
-        LSurfaceView::paintEvent(params);
+        paintDefault();
         return;
     }
 
-    // TODO: 将当前该surface可见的屏幕都执行一遍
-
-    if(surface()->outputs().empty()){
-        // 如果为空, 说明当前outputs可能处于被重置中的状态(例如, 屏幕物理属性发生改变, 期间没有outputs)
+    if (params.region->empty()) {
         return;
     }
 
-    LOutput *out = surface()->outputs()[0];
+    // 半透明阶段按从下到上的顺序绘制, 与已攒下的窗口重叠(例如层叠窗口的圆角)时必须先画出下面的窗口
+    if (decorations.overlaps(*params.region)) {
+        decorations.flush(params.painter, resources.state);
+    }
+
+    // 客户端声明为不透明的区域, 窗口内部的这部分可以不开混合直接覆盖
+    LRegion opaque = surface()->opaqueRegion();
+    opaque.offset(pos());
 
-    if(!out){
-        // 这个surface没有被映射, 不用绘制了
+    // 由于Louvre的多线程特性, 一个texture的buffer不是线程共享的, 而是每个屏幕一个对象, 因此按正在绘制的屏幕获取
+    if (!decorations.add(framebuffer, surface()->texture()->id(output), LRect(pos(), size()), *params.region, &opaque, WINDOW_STYLE)) {
+        // 攒下的窗口属于另一个绘制目标(嵌套的离屏场景), 这个窗口直接用默认方法绘制
+        LSurfaceView::paintEvent(params);
         return;
     }
 
-    // 保存先前视口
-    GLint old_viewport[4];
-    glGetIntegerv(GL_VIEWPORT, old_viewport);
-
-
-    // --- 准备 OpenGL 状态 ---
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    // --- 激活着色器和几何体 ---
-    shader->use();
-    // --- 绑定纹理 ---
-    glActiveTexture(GL_TEXTURE0);
-    // TODO: 由于Louvre的多线程特性, 一个texture的buffer不是线程共享的, 而是每个屏幕一个对象。这里需要用更好的方式获取当前屏幕
-    // 我们暂时传入nullptr, 默认指定为主线程(main thread)的buffer
-    glBindTexture(GL_TEXTURE_2D, surface()->texture()->id(output));
-    glBindBuffer(GL_ARRAY_BUFFER, server.quadVBO());
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, server.quadEBO());
-
-    // 万能的GPU啊, 你要这样解释数据格式...
-    // 这个是属性0: 是我要渲染的坐标
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-
-    // 这个是属性1: 是纹理坐标
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    // ...麻烦您把这两个之间映射起来, 谢谢
-
-    const float scale = out->scale();              // 获取缩放比例, e.g., 2.0 for 200% scaling
-    const LSize &logical_size = out->size();       // 逻辑尺寸, e.g., 1920x1080
-    const LSize &physical_size = out->sizeB();     // 物理缓冲区尺寸, e.g., 3840x2160
-
-    // 定义圆角半径(逻辑像素, 需要根据实际分辨率放大)
-    const float cornerRadius = 8.f; // TODO: 圆角半径, 可以从配置文件读取
-    const float borderWidth = 2.f;  // 边框粗细
-
-    shader->setUniform("u_texture", 0);
-    shader->setUniform("u_resolution", LSizeF(size()));
-    // 传递给着色器的像素值,都需要乘以缩放比例
-    shader->setUniform("u_radius", cornerRadius * scale);
-    shader->setUniform("u_border_width", borderWidth * scale);
-    // 设置边框颜色为白色 (R=1.0, G=1.0, B=1.0)
-    shader->setUniform("u_border_color", glm::vec3(1.0f, 1.0f, 1.0f));
-
-    glm::mat4 projection_matrix = glm::ortho(0.0f, (float)logical_size.w(), (float)logical_size.h(), 0.0f, -1.0f, 1.0f);
-
-    // 2. 创建模型矩阵
-    // 从一个单位矩阵开始
-    glm::mat4 model_matrix = glm::mat4(1.0f);
-    // a. 平移：将我们的单位矩形的原点移动到视图的左上角位置(偏移进行补偿)
-    model_matrix = glm::translate(model_matrix, glm::vec3(pos().x() - cornerRadius, pos().y() - cornerRadius, 0.0f));
-    // b. 缩放：将我们的单位矩形(1x1)缩放到视图的实际大小(扩大3倍进行裁剪补偿, 防止视觉边距过大)
-    model_matrix = glm::scale(model_matrix, glm::vec3(size().w() + 3 * cornerRadius, size().h() + 3 * cornerRadius, 1.0f));
-    // 3. 计算最终变换
-    glm::mat4 final_transform = projection_matrix * model_matrix;
-    // 4. 将矩阵传递给着色器
-    GLuint transformLoc = glGetUniformLocation(shader->id(), "u_transform");
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(final_transform));
-
-    glViewport(0, 0, physical_size.w(), physical_size.h());
-    
-    glEnable(GL_SCISSOR_TEST); // 启用剪裁测试
-
-    Int32 n;
-    const LBox *boxes = region->boxes(&n);
-    for (Int32 i = 0; i < n; i++) {
-        const LBox &box = boxes[i];
-        
-        Int32 physical_x = box.x1 * scale;
-        Int32 physical_y = box.y1 * scale;
-        Int32 physical_w = (box.x2 - box.x1) * scale;
-        Int32 physical_h = (box.y2 - box.y1) * scale;
-
-        // gl坐标系是从左下角开始的(和笛卡尔平面坐标系一致), 而Louvre(或者说计算机坐标系)左上角是原点, 因此需要翻转y轴
-        glScissor(physical_x, physical_size.h() - (physical_y + physical_h), physical_w, physical_h);
-        
-        // 在这个小小的剪裁区域内,执行我们的绘制命令
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    // 主线程的离屏绘制(例如窗口缩略图)没有屏幕帧来统一绘制, 立即绘制
+    if (!output) {
+        decorations.flush(params.painter, resources.state);
     }
+}
 
+const LRegion * SurfaceView::translucentRegion() const noexcept{
+    if(!surface() || !surface()->toplevel()){
+        return LSurfaceView::translucentRegion();
+    }
 
-    // 清理, 还原状态机绘制之前的状态
-    glDisable(GL_SCISSOR_TEST);
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glUseProgram(0);
-    glDisable(GL_BLEND);
+    // 窗口是自定义绘制的: 圆角和抗锯齿边缘总是半透明的, 其余部分取决于客户端声明的不透明区域
+    // 场景据此跳过被完全遮挡的窗口、壁纸和背景层
+    const Int32 w = size().w();
+    const Int32 h = size().h();
 
-    glViewport(old_viewport[0], old_viewport[1], old_viewport[2], old_viewport[3]);
+    m_translucentRegion.clear();
+    m_translucentRegion.addRect(0, 0, w, h);
 
-    params.painter->bindProgram();
+    // 移动中的窗口整体半透明
+    if(colorFactor().a < 1.f){
+        return &m_translucentRegion;
+    }
 
-    
-}
+    LRegion opaque = surface()->opaqueRegion();
+    opaque.clip(LRect(ANTI_ALIAS_WIDTH, ANTI_ALIAS_WIDTH, w - 2 * ANTI_ALIAS_WIDTH, h - 2 * ANTI_ALIAS_WIDTH));
 
-const LRegion * SurfaceView::translucentRegion() const noexcept{
-    if(surface() && surface()->toplevel()){
-        return nullptr;
-    }else{
-        return LSurfaceView::translucentRegion();
-    }
-}
\ No newline at end of file
+    const Int32 r = (Int32)std::ceil(WINDOW_STYLE.radius);
+    opaque.subtractRect(LRect(0, 0, r, r));
+    opaque.subtractRect(LRect(w - r, 0, r, r));
+    opaque.subtractRect(LRect(0, h - r, r, r));
+    opaque.subtractRect(LRect(w - r, h - r, r, r));
+
+    m_translucentRegion.subtractRegion(opaque);
+    return &m_translucentRegion;
+}
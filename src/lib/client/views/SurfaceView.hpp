@@ -1,7 +1,7 @@
 #pragma once
 
+#include <LRegion.h>
 #include <LSurfaceView.h>
-#include "src/test/PerfmonRegistry.hpp"
 #include "src/lib/surface/Surface.hpp"
 using namespace Louvre;
 
@@ -17,8 +17,10 @@ namespace tiley{
             ~SurfaceView() noexcept;
 
             void paintEvent(const PaintEventParams& params) noexcept override;
+            // translucentRegion: for windows, rounded corners, anti-aliased edges and parts the client did not declare opaque
             const LRegion * translucentRegion() const noexcept override;
-    };
-   PerformanceMonitor& perfmon(); 
 
+        private:
+            mutable LRegion m_translucentRegion;
+    };
 }
\ No newline at end of file
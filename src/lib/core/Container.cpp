@@ -2,23 +2,19 @@
 #include "LLayerView.h"
 #include "src/lib/TileyServer.hpp"
 #include "src/lib/client/ToplevelRole.hpp"
+#include "src/lib/client/views/SurfaceView.hpp"
+#include "src/lib/input/SurfaceIndex.hpp"
 #include "src/lib/types.hpp"
 
 #include <LSurfaceView.h>
+#include <LCompositor.h>
 #include <LLog.h>
 #include <memory>
 
 using namespace tiley;
 
-// Constructor for splitting containers
-Container::Container(){
-    this->child1 = nullptr;
-    this->child2 = nullptr;
-    this->splitType = SPLIT_NONE;
-}
-
 // Constructor for windows
-Container::Container(ToplevelRole* window) : Container::Container(){
+Container::Container(ToplevelRole* window){
     this->window = window;
     window->container = this;
 
@@ -47,6 +43,77 @@ void Container::printContainerWindowInfo(){
     }
 }
 
+void Container::geometryChanged(){
+
+    const LayoutRect& area = geometry();
+
+    LLog::debug("[reflow]: window recalculated, size: %dx%d, pos: (%d,%d)", area.w, area.h, area.x, area.y);
+
+    Surface* surface = static_cast<Surface*>(window->surface());
+
+    if(!surface || !surface->mapped()){
+        return;
+    }
+
+    const LRect areaForWindow = windowArea();
+
+    // ask the client for the new size now, views are moved once the layout transaction commits
+    window->configureSize(areaForWindow.size());
+    window->setExtraGeometry({GAP, GAP, GAP, GAP});
+
+    // a window already having the requested size will not send anything back
+    bool awaitCommit = window->windowGeometry().size() != areaForWindow.size();
+    TileyWindowStateManager::getInstance().layoutTransaction().add(this, awaitCommit);
+}
+
+void Container::applyGeometry(){
+
+    Surface* surface = static_cast<Surface*>(window->surface());
+
+    // the window left the tiling layout(moving, stacking...) before the transaction committed
+    if(!surface || !surface->mapped() || !parent() || floating_reason != NONE){
+        return;
+    }
+
+    const LayoutRect& area = geometry();
+    const LRect areaForWindow = windowArea();
+
+    containerView->setPos(areaForWindow.pos());
+    containerView->setSize(areaForWindow.size());
+
+    surface->setPos(area.x, area.y);
+    SurfaceIndex::invalidateAll();
+
+    LLog::debug("[applyGeometry]: children of containerView: %zu", containerView->children().size());
+    SurfaceView* surfaceView = static_cast<SurfaceView*>(containerView->children().front());
+
+    const LRect& windowGeometry = window->windowGeometry();
+
+    // if window does not support server side decorations and window draws its own decorations
+    if(!window->supportServerSideDecorations() && (windowGeometry.x() > 0 || windowGeometry.y() > 0)){
+        // set a custom position to align main part of window to upper-left corner
+        surfaceView->setCustomPos(-windowGeometry.x(), -windowGeometry.y());
+    }
+}
+
+LRect Container::windowArea() const{
+
+    const LayoutRect& area = geometry();
+
+    LRect areaForWindow = {
+        area.x + GAP,
+        area.y + GAP,
+        area.w - GAP * 2,
+        area.h - GAP * 2
+    };
+
+    // avoid negative geometry of windows too small
+    if (areaForWindow.w() < 50) areaForWindow.setW(50);
+    if (areaForWindow.h() < 50) areaForWindow.setH(50);
+
+    return areaForWindow;
+}
+
 // enable when container is tiled otherwise disable
 void Container::enableContainerView(bool enable){
 
@@ -99,4 +166,9 @@ void Container::disableContainerFeatures(){
     }
 }
 
-Container::~Container(){}
\ No newline at end of file
+Container::~Container(){
+    // the window outlives its container when it leaves the tiling layout for good
+    if(window && static_cast<ToplevelRole*>(window)->container == this){
+        static_cast<ToplevelRole*>(window)->container = nullptr;
+    }
+}
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "src/lib/TileyWindowStateManager.hpp"
+#include "src/lib/layout/LayoutNode.hpp"
 #include "src/lib/types.hpp"
 #include "src/lib/surface/Surface.hpp"
 #include "src/lib/client/ToplevelRole.hpp"
@@ -20,36 +21,46 @@ namespace tiley{
 
 namespace tiley{
     
-    // A container represents a parent for splitting or a window.
-    // Container tree is consisted of container and mainly used for dynamic tiling algorithms
-    class Container{
+    // A container represents a window in the tiling tree.
+    // Tree structure and geometry are handled by `LayoutNode`/`LayoutEngine`, container adds the Louvre side of a tiled window.
+    class Container final : public LayoutNode{
         public:
-            inline const LRect& getGeometry(){return geometry;}
+            inline LRect getGeometry() const { return LRect(geometry().x, geometry().y, geometry().w, geometry().h); }
             inline LLayerView* getContainerView(){ return containerView.get(); }
             inline LToplevelRole* getWindow(){return window;}
+            inline UInt32 getWorkspaceId() const { return workspaceId; }
+            // handle: slot of this container in the manager's container pool
+            inline SlabHandle handle() const { return m_handle; }
             void printContainerWindowInfo();
-            // call constructor with a null window is no-op
             Container(ToplevelRole* window);
-            Container();
             ~Container();
+
+            // applyGeometry: move views of the window to the geometry configured by the last reflow.
+            // Called by `LayoutTransaction` once the client acked the new size.
+            void applyGeometry();
+
+        protected:
+            // configure the window with geometry assigned by reflow
+            void geometryChanged() override;
+
         private:
-            // Dynamic tiling: split Type
-            SPLIT_TYPE splitType;
+            // window visual gap
+            static constexpr Int32 GAP = 5;
+
+            // windowArea: geometry of the window inside this container, without the gap
+            LRect windowArea() const;
+
             // Dynamic tiling: why a window is temporarily floating
             FLOATING_REASON floating_reason = NONE;
+
+            // workspace of the tree this container is inserted into, assigned by the manager
+            UInt32 workspaceId = DEFAULT_WORKSPACE;
+
+            // assigned by the manager right after creation
+            SlabHandle m_handle;
             
             // TODO: LWeak or unique_ptr
             LToplevelRole* window = nullptr; // nonnull when for a window
-
-            Container* parent = nullptr;
-            Container* child1;
-            Container* child2;
-            
-            // Dynamic tiling: used by splitting containers, ignored by window containers
-            Float32 splitRatio = 0.5;
-
-            // Isolated geometry data for caching realtime window geometry to avoid chaotic updates
-            LRect geometry;
             
             // An invisible wrapper view for window typed containers, convenient for decoration or clipping
             std::unique_ptr<LLayerView> containerView = nullptr;
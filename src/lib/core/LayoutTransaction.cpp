@@ -0,0 +1,159 @@
+#include "LayoutTransaction.hpp"
+
+#include "src/lib/client/ToplevelRole.hpp"
+#include "src/lib/core/Container.hpp"
+#include "src/lib/TileyServer.hpp"
+
+#include <LCompositor.h>
+#include <LLog.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace tiley;
+
+LayoutTransaction::LayoutTransaction(const SlabPool<Container>& containers) : m_containers(containers){
+
+    if(const char* timeoutEnv = getenv("TILEY_LAYOUT_TIMEOUT_MS")){
+        int timeoutMs = atoi(timeoutEnv);
+        if(timeoutMs > 0){
+            m_timeoutMs = (UInt32)timeoutMs;
+        }else{
+            LLog::warning("[LayoutTransaction]: invalid TILEY_LAYOUT_TIMEOUT_MS: %s, using %u ms", timeoutEnv, m_timeoutMs);
+        }
+    }
+
+    // slow clients must not hold fast ones back forever
+    m_timeoutTimer.setCallback([this](LTimer*){
+        LLog::debug("[LayoutTransaction]: %u window(s) did not commit in %u ms, applying layout anyway", m_awaitingCount, m_timeoutMs);
+        commit();
+    });
+}
+
+LayoutTransaction::~LayoutTransaction(){
+    if(m_timeoutTimer.running()){
+        m_timeoutTimer.stop();
+    }
+}
+
+void LayoutTransaction::clear(){
+    if(m_timeoutTimer.running()){
+        m_timeoutTimer.stop();
+    }
+    m_entries.clear();
+    m_awaitingCount = 0;
+}
+
+void LayoutTransaction::setTimeout(UInt32 timeoutMs){
+    m_timeoutMs = timeoutMs;
+}
+
+std::vector<LayoutTransaction::Entry>::iterator LayoutTransaction::find(SlabHandle container){
+    return std::find_if(m_entries.begin(), m_entries.end(), [container](const Entry& entry){
+        return entry.container == container;
+    });
+}
+
+void LayoutTransaction::add(Container* container, bool awaitCommit){
+
+    SlabHandle handle = container ? container->handle() : SlabHandle{};
+    if(!m_containers.get(handle)){
+        return;
+    }
+
+    auto it = find(handle);
+
+    if(it == m_entries.end()){
+        m_entries.push_back({handle, false});
+        it = m_entries.end() - 1;
+    }
+
+    // a new configuration is sent, the window has to ack it again
+    if(awaitCommit && !it->awaitingCommit){
+        it->awaitingCommit = true;
+        m_awaitingCount++;
+    }
+
+    if(m_awaitingCount == 0){
+        // nobody to wait for, nothing on screen needs to be held
+        commit();
+        return;
+    }
+
+    // joining an open transaction does not extend it
+    if(!m_timeoutTimer.running()){
+        m_timeoutTimer.start(m_timeoutMs);
+    }
+}
+
+void LayoutTransaction::remove(Container* container){
+
+    if(!container){
+        return;
+    }
+    auto it = find(container->handle());
+
+    if(it == m_entries.end()){
+        return;
+    }
+
+    if(it->awaitingCommit){
+        m_awaitingCount--;
+    }
+    m_entries.erase(it);
+
+    if(m_entries.empty()){
+        if(m_timeoutTimer.running()){
+            m_timeoutTimer.stop();
+        }
+    }else if(m_awaitingCount == 0){
+        commit();
+    }
+}
+
+void LayoutTransaction::windowCommitted(ToplevelRole* window){
+
+    if(!window || !window->container || m_awaitingCount == 0){
+        return;
+    }
+
+    // the client is still processing a configuration sent later than its last commit
+    if(window->serial() != window->pendingConfiguration().serial){
+        return;
+    }
+
+    auto it = find(window->container->handle());
+    if(it != m_entries.end() && it->awaitingCommit){
+        it->awaitingCommit = false;
+        m_awaitingCount--;
+    }
+
+    if(m_awaitingCount == 0){
+        commit();
+    }
+}
+
+void LayoutTransaction::commit(){
+
+    if(m_timeoutTimer.running()){
+        m_timeoutTimer.stop();
+    }
+
+    // take the entries first, applying geometry may start a new transaction
+    std::vector<Entry> entries;
+    entries.swap(m_entries);
+    m_awaitingCount = 0;
+
+    DamageAccumulator& damage = TileyServer::getInstance().damage();
+
+    for(Entry& entry : entries){
+        // the window may have been closed since it was configured
+        if(Container* container = m_containers.get(entry.container)){
+            // where the window was and where it goes
+            LLayerView* view = container->getContainerView();
+            damage.add(LRect(view->pos(), view->size()));
+            container->applyGeometry();
+            damage.add(LRect(view->pos(), view->size()));
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <LNamespaces.h>
+#include <LTimer.h>
+#include <vector>
+
+#include "src/lib/layout/SlabPool.hpp"
+
+using namespace Louvre;
+
+namespace tiley{
+    class Container;
+    class ToplevelRole;
+}
+
+namespace tiley{
+
+    // A layout transaction collects windows configured by one or more reflows.
+    // Windows keep their previous on-screen geometry until every one of them has committed the configuration
+    // sent for the new layout(or the timeout expires), then all of them move at once.
+    class LayoutTransaction{
+        public:
+            // containers are referenced by handles of `containers`, windows closing mid-transaction are simply skipped
+            LayoutTransaction(const SlabPool<Container>& containers);
+            ~LayoutTransaction();
+
+            LayoutTransaction(const LayoutTransaction&) = delete;
+            LayoutTransaction& operator=(const LayoutTransaction&) = delete;
+
+            // add: `container` has been configured with a new geometry. If `awaitCommit` is false the window
+            // already has the requested size and does not hold the transaction back.
+            void add(Container* container, bool awaitCommit);
+            // remove: forget `container`, e.g. it is being destroyed
+            void remove(Container* container);
+            // windowCommitted: `window` committed new atoms, the transaction is applied if it was the last one awaited
+            void windowCommitted(ToplevelRole* window);
+
+            // clear: drop pending geometry without applying it and stop the timeout, e.g. the compositor is shutting down
+            void clear();
+
+            // pending: some geometry is waiting to be applied
+            inline bool pending() const { return !m_entries.empty(); }
+
+            // timeout: how long(ms) slow clients may hold the transaction back
+            inline UInt32 timeout() const { return m_timeoutMs; }
+            void setTimeout(UInt32 timeoutMs);
+
+            // default timeout, can be overridden by the `TILEY_LAYOUT_TIMEOUT_MS` environment variable
+            static constexpr UInt32 DEFAULT_TIMEOUT_MS = 200;
+
+        private:
+            struct Entry{
+                SlabHandle container;
+                bool awaitingCommit;
+            };
+
+            // find: entry of `container`, or end of entries
+            std::vector<Entry>::iterator find(SlabHandle container);
+
+            // apply geometry of every window at once
+            void commit();
+
+            const SlabPool<Container>& m_containers;
+            std::vector<Entry> m_entries;
+            UInt32 m_awaitingCount = 0;
+            UInt32 m_timeoutMs = DEFAULT_TIMEOUT_MS;
+            LTimer m_timeoutTimer;
+    };
+}
@@ -31,7 +31,7 @@ void stopMoveSession(bool recalculateLayout){
                     // TODO: Allow insert to another monitor
                     if(attached){
                         manager.reapplyWindowState(window);
-                        manager.recalculate();
+                        manager.scheduleRecalculate();
                     }
                 }
             }
@@ -13,7 +13,13 @@
 #include "Keyboard.hpp"
 #include "ShortcutManager.hpp"
 #include "src/lib/TileyServer.hpp"
+#include "src/lib/TileyWindowStateManager.hpp"
+#include "src/lib/client/ToplevelRole.hpp"
 #include "src/lib/core/UserAction.hpp"
+#include "src/lib/ipc/IPCManager.hpp"
+#include "src/lib/output/Output.hpp"
+#include "src/lib/surface/Surface.hpp"
+#include "src/test/PerfmonRegistry.hpp"
 
 #include <algorithm>
 #include <cctype>
@@ -53,6 +59,13 @@ static std::string buildComboFromEvent(const Louvre::LKeyboardKeyEvent& event, L
 }
 
 void Keyboard::keyEvent(const Louvre::LKeyboardKeyEvent& event){
+    // 输入到显示的延迟: 只有产生了damage的输入才会被测量, 来源是焦点窗口收到按键后提交的damage,
+    // 或者处理按键时(例如快捷键)tiley自己产生的damage
+    if (tiley::perfmonEnabled() && focus()) {
+        static_cast<Surface*>(focus())->markInput(event.us());
+    }
+    const InputDamageScope inputDamage(TileyServer::getInstance().damage(), event.us());
+
     // 父类部分处理逻辑下移
     const bool L_CTRL      { isKeyCodePressed(KEY_LEFTCTRL)  };
     const bool L_SHIFT     { isKeyCodePressed(KEY_LEFTSHIFT) };
@@ -90,4 +103,15 @@ void Keyboard::keyEvent(const Louvre::LKeyboardKeyEvent& event){
         if (L_CTRL) { seat()->dnd()->setPreferredAction(LDND::Copy); }
         else if (L_SHIFT) { seat()->dnd()->setPreferredAction(LDND::Move); }
     }
-}
\ No newline at end of file
+}
+
+void Keyboard::focusChanged(){
+    LKeyboard::focusChanged();
+    // floating windows are focused without going through the window manager
+    TileyWindowStateManager::getInstance().markStateChanged();
+
+    // layer surfaces(bars, launchers) and popups are not windows
+    if(focus() && focus()->toplevel()){
+        IPCManager::getInstance().broadcastWindowEvent(static_cast<ToplevelRole*>(focus()->toplevel()), "focus");
+    }
+}
@@ -14,6 +14,7 @@ namespace tiley{
         public:
             using LKeyboard::LKeyboard;
             void keyEvent(const LKeyboardKeyEvent& event) override;
+            void focusChanged() override;
     };
     //先全部在cpp申明了,跑通再说。
     /*
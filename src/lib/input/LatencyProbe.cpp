@@ -0,0 +1,88 @@
+#include "LatencyProbe.hpp"
+
+#include "src/lib/TileyServer.hpp"
+#include "src/test/PerfmonRegistry.hpp"
+
+#include <LCursor.h>
+#include <LLog.h>
+#include <LPointer.h>
+#include <LPointerMoveEvent.h>
+#include <LSeat.h>
+#include <LTime.h>
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace tiley;
+
+std::unique_ptr<LatencyProbe, LatencyProbe::LatencyProbeDeleter> LatencyProbe::INSTANCE = nullptr;
+std::once_flag LatencyProbe::onceFlag;
+
+LatencyProbe& LatencyProbe::getInstance() {
+    std::call_once(onceFlag, []() {
+        INSTANCE.reset(new LatencyProbe());
+    });
+    return *INSTANCE;
+}
+
+LatencyProbe::LatencyProbe() {
+    m_timer.setCallback([this](LTimer*){
+        tick();
+        // the timer is one-shot
+        if (m_intervalMs) {
+            m_timer.start(m_intervalMs);
+        }
+    });
+}
+
+void LatencyProbe::initialize() {
+    const char* env = getenv("TILEY_LATENCY_PROBE");
+    if (!env) {
+        return;
+    }
+
+    const int intervalMs = atoi(env);
+    if (intervalMs <= 0) {
+        LLog::warning("[LatencyProbe::initialize]: invalid TILEY_LATENCY_PROBE: %s, expected an interval in milliseconds", env);
+        return;
+    }
+
+    if (!perfmonEnabled()) {
+        LLog::warning("[LatencyProbe::initialize]: perfmon is off, latencies are only recorded once it gets enabled");
+    }
+
+    start((UInt32)intervalMs);
+}
+
+void LatencyProbe::start(UInt32 intervalMs) {
+    m_intervalMs = intervalMs;
+    m_timer.start(intervalMs);
+    LLog::log("[LatencyProbe::start]: synthetic input every %u ms", intervalMs);
+}
+
+void LatencyProbe::stop() {
+    m_intervalMs = 0;
+    m_timer.stop();
+}
+
+void LatencyProbe::tick() {
+    if (!seat()->pointer() || !cursor()->output()) {
+        return;
+    }
+
+    // goes through the same path as libinput events, stamped like them
+    LPointerMoveEvent event;
+    event.setDelta({m_direction, 0.f});
+    event.setDeltaUnaccelerated({m_direction, 0.f});
+    event.setMs(LTime::ms());
+    event.setUs(LTime::us());
+    m_direction = -m_direction;
+
+    seat()->pointer()->pointerMoveEvent(event);
+
+    // a hardware cursor moves without compositing, make the probe visible to the scene like typing into a window would,
+    // the damage is stamped with the probe's input
+    const InputDamageScope inputDamage(TileyServer::getInstance().damage(), event.us());
+    const LPointF& pos = cursor()->pos();
+    TileyServer::getInstance().damage().add(LRect((Int32)std::floor(pos.x()), (Int32)std::floor(pos.y()), 1, 1));
+}
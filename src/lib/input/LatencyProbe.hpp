@@ -0,0 +1,45 @@
+#pragma once
+
+#include <LNamespaces.h>
+#include <LTimer.h>
+
+#include <memory>
+#include <mutex>
+
+namespace tiley {
+
+    using namespace Louvre;
+
+    // LatencyProbe: synthetic pointer motion standing in for a real input device, so input-to-photon latency
+    // can be regression-tested on any machine(`TILEY_LATENCY_PROBE=<interval ms>`, needs perfmon enabled).
+    // Every tick nudges the cursor by one pixel back and forth through Pointer::pointerMoveEvent, stamped with the current time.
+    class LatencyProbe {
+        public:
+            static LatencyProbe& getInstance();
+            struct LatencyProbeDeleter {
+                void operator()(LatencyProbe* p) const { delete p; }
+            };
+
+            // initialize: start probing if TILEY_LATENCY_PROBE is set
+            void initialize();
+            void start(UInt32 intervalMs);
+            void stop();
+
+        private:
+            LatencyProbe();
+            ~LatencyProbe() = default;
+
+            LatencyProbe(const LatencyProbe&) = delete;
+            LatencyProbe& operator=(const LatencyProbe&) = delete;
+
+            static std::unique_ptr<LatencyProbe, LatencyProbeDeleter> INSTANCE;
+            static std::once_flag onceFlag;
+
+            void tick();
+
+            Louvre::LTimer m_timer;
+            UInt32 m_intervalMs = 0;
+            // direction of the next one pixel nudge
+            Float32 m_direction = 1.f;
+    };
+}
@@ -5,6 +5,7 @@
 #include "src/lib/TileyWindowStateManager.hpp"
 #include "src/lib/client/ToplevelRole.hpp"
 #include "src/lib/core/UserAction.hpp"
+#include "src/lib/output/Output.hpp"
 #include "src/lib/surface/Surface.hpp"
 #include "src/lib/types.hpp"
 #include "src/lib/core/Container.hpp"
@@ -26,44 +27,167 @@
 
 #include <LToplevelMoveSession.h>
 
-#include <private/LCompositorPrivate.h>
+#include <cstdlib>
+#include <cstring>
 
 using namespace tiley;
 
-LSurface* Pointer::surfaceAtWithFilter(const LPoint& point, const std::function<bool (LSurface*)> &filter){
-    retry:
-    // 保留 Louvre 的健壮性设计,防止在遍历时列表被修改
-    compositor()->imp()->surfacesListChanged = false;
+const SurfaceIndex* Pointer::surfaceIndexAt(const LPoint& point){
 
-    // 从 rbegin() 到 rend() 是逆序遍历,即从最顶层的窗口开始
-    for (auto it = compositor()->surfaces().rbegin(); it != compositor()->surfaces().rend(); ++it)
-    {
-        LSurface *s = *it;
+    // the cursor output is almost always the one
+    Output* output = static_cast<Output*>(cursor()->output());
 
-        // 基础检查：窗口必须是可见的
-        if (s->mapped() && !s->minimized())
-        {
-            // 几何检查：鼠标指针是否在该窗口的输入区域内？
-            if (s->inputRegion().containsPoint(point - s->rolePos()))
-            {
-                // 关键一步：在确认几何位置匹配后,执行我们自定义的 lambda 过滤器
-                if (filter(s))
-                {
-                    // 如果过滤器返回 true,说明我们找到了完美的匹配！
-                    return s;
-                }
-                // 如果过滤器返回 false,我们什么也不做,继续循环,
-                // 查找这个窗口下面的、同样在该坐标点、且可能满足条件的窗口。
+    if(!output || !output->rect().containsPoint(point)){
+        output = nullptr;
+        for(LOutput* o : compositor()->outputs()){
+            if(o->rect().containsPoint(point)){
+                output = static_cast<Output*>(o);
+                break;
             }
         }
+    }
+
+    if(!output){
+        return nullptr;
+    }
+
+    SurfaceIndex& index = output->surfaceIndex();
+    if(index.stale()){
+        index.rebuild(output->rect());
+    }
+    return &index;
+}
+
+const PointerHit& Pointer::hitTest(const LPointF& point){
+
+    const LPoint pos = point;
+    const SurfaceIndex* index = surfaceIndexAt(pos);
+
+    // several consumers of the same move event share one lookup
+    if(index && index == m_lastHitIndex && index->generation() == m_lastHitGeneration && pos == m_lastHitPoint){
+        return m_lastHit;
+    }
+
+    m_lastHit = {};
+    m_lastHitPoint = pos;
+    m_lastHitIndex = index;
+    m_lastHitGeneration = index ? index->generation() : 0;
+
+    if(!index){
+        return m_lastHit;
+    }
+
+    TileyWindowStateManager& manager = TileyWindowStateManager::getInstance();
+
+    // one walk from the top fills every field, stop as soon as all of them are known
+    index->forEachAt(pos, [this, &manager](LSurface* s){
+        Surface* surface = static_cast<Surface*>(s);
+
+        if(!m_lastHit.surface){
+            m_lastHit.surface = s;
+        }
+
+        const bool visible = surface->getView() && surface->getView()->visible();
+        if(!visible){
+            return false;
+        }
+
+        if(!m_lastHit.focusable){
+            m_lastHit.focusable = s;
+        }
+
+        if(!m_lastHit.tiledWindow && s->toplevel() && manager.isTiledWindow(static_cast<ToplevelRole*>(s->toplevel()))){
+            m_lastHit.tiledWindow = s;
+        }
+
+        return m_lastHit.tiledWindow != nullptr;
+    });
+
+    return m_lastHit;
+}
+
+bool Pointer::motionFrameCapRequested(){
+    const char* env = getenv("TILEY_POINTER_FRAME_CAP");
+    return env && strcmp(env, "1") == 0;
+}
+
+void Pointer::pointerMoveEvent(const LPointerMoveEvent& event){
+    TILEY_TRACE_ZONE("Pointer::pointerMoveEvent");
+
+    if(!m_motionFrameCap){
+        processPointerMoveEvent(event);
+        return;
+    }
+
+    // batch raw motion, focus is resolved once per output refresh
+    if(m_pendingMotion){
+        m_pendingMotion->setDelta(m_pendingMotion->delta() + event.delta());
+        m_pendingMotion->setDeltaUnaccelerated(m_pendingMotion->deltaUnaccelerated() + event.deltaUnaccelerated());
+        m_pendingMotion->setMs(event.ms());
+        m_pendingMotion->setUs(event.us());
+        m_pendingMotion->setSerial(event.serial());
+    }else{
+        m_pendingMotion = event;
+        // make sure a frame comes to flush the motion
+        if(cursor()->output()){
+            cursor()->output()->repaint();
+        }
+    }
+}
 
-        // 再次检查列表是否被修改,如果被修改,就从头再来一次
-        if (compositor()->imp()->surfacesListChanged)
-            goto retry;
+void Pointer::flushPendingMotion(){
+    if(!m_pendingMotion){
+        return;
     }
 
-    // 遍历完所有窗口都没有找到匹配
-    return nullptr;
+    LPointerMoveEvent event = *m_pendingMotion;
+    m_pendingMotion.reset();
+    processPointerMoveEvent(event);
+}
+
+void Pointer::pointerScrollEvent(const LPointerScrollEvent& event){
+    flushPendingMotion();
+    LPointer::pointerScrollEvent(event);
+}
+
+void Pointer::pointerSwipeBeginEvent(const LPointerSwipeBeginEvent& event){
+    flushPendingMotion();
+    LPointer::pointerSwipeBeginEvent(event);
+}
+
+void Pointer::pointerSwipeUpdateEvent(const LPointerSwipeUpdateEvent& event){
+    flushPendingMotion();
+    LPointer::pointerSwipeUpdateEvent(event);
+}
+
+void Pointer::pointerSwipeEndEvent(const LPointerSwipeEndEvent& event){
+    flushPendingMotion();
+    LPointer::pointerSwipeEndEvent(event);
+}
+
+void Pointer::pointerPinchBeginEvent(const LPointerPinchBeginEvent& event){
+    flushPendingMotion();
+    LPointer::pointerPinchBeginEvent(event);
+}
+
+void Pointer::pointerPinchUpdateEvent(const LPointerPinchUpdateEvent& event){
+    flushPendingMotion();
+    LPointer::pointerPinchUpdateEvent(event);
+}
+
+void Pointer::pointerPinchEndEvent(const LPointerPinchEndEvent& event){
+    flushPendingMotion();
+    LPointer::pointerPinchEndEvent(event);
+}
+
+void Pointer::pointerHoldBeginEvent(const LPointerHoldBeginEvent& event){
+    flushPendingMotion();
+    LPointer::pointerHoldBeginEvent(event);
+}
+
+void Pointer::pointerHoldEndEvent(const LPointerHoldEndEvent& event){
+    flushPendingMotion();
+    LPointer::pointerHoldEndEvent(event);
 }
 
 void Pointer::printPointerPressedSurfaceDebugInfo(){
@@ -89,6 +213,9 @@ void Pointer::printPointerPressedSurfaceDebugInfo(){
 
 void Pointer::pointerButtonEvent(const LPointerButtonEvent& event){
 
+    // a click right after a move must hit what is under the cursor now
+    flushPendingMotion();
+
     TileyServer& server = TileyServer::getInstance();
     Surface* surface = static_cast<Surface*>(surfaceAt(cursor()->pos()));
 
@@ -387,7 +514,7 @@ bool Pointer::processCompositorKeybind(const LPointerButtonEvent& event){
             if(detachedContainer){
                 // 如果分离成功, 重新组织并重新布局
                 manager.reapplyWindowState(window);
-                manager.recalculate();
+                manager.scheduleRecalculate();
             }
         }
 
@@ -410,12 +537,35 @@ bool Pointer::processCompositorKeybind(const LPointerButtonEvent& event){
     return false;
 }
 
-void Pointer::pointerMoveEvent(const LPointerMoveEvent& event){
+void Pointer::processPointerMoveEvent(const LPointerMoveEvent& event){
+    TILEY_TRACE_ZONE("Pointer::processPointerMoveEvent");
+
+    // input-to-photon latency, only measured for motion that damages something: the hovered window redrawing,
+    // a cursor composited by the scene, or tiley's own damage(dragged windows...) while handling it
+    if(tiley::perfmonEnabled()){
+        if(focus()){
+            static_cast<Surface*>(focus())->markInput(event.us());
+        }
+        if(cursor()->output() && !cursor()->hasHardwareSupport(cursor()->output())){
+            static_cast<Output*>(cursor()->output())->markInput(event.us());
+        }
+    }
+    const InputDamageScope inputDamage(TileyServer::getInstance().damage(), event.us());
+
+    // consumers of this event share one hit-test, the previous one may be stale: surfaces not indexed(popups...)
+    // move without invalidating the index
+    m_lastHitIndex = nullptr;
     //LLog::debug("鼠标移动事件");
 
     // 首先移动光标位置, 确保后续的操作是更新过的位置
     // Update the cursor position
     cursor()->move(event.delta().x(), event.delta().y());
+
+    // IPC replies report the output under the cursor as focused
+    if(cursor()->output() != m_cursorOutput){
+        m_cursorOutput = cursor()->output();
+        TileyWindowStateManager::getInstance().markStateChanged();
+    }
  
     // 指针是否被范围限制?
     bool pointerConstrained { false };
@@ -486,6 +636,7 @@ void Pointer::pointerMoveEvent(const LPointerMoveEvent& event){
         if (seat()->dnd()->icon())
         {
             seat()->dnd()->icon()->surface()->setPos(cursor()->pos());
+            SurfaceIndex::invalidateAll();
             seat()->dnd()->icon()->surface()->repaintOutputs();
             cursor()->setCursor(seat()->dnd()->icon()->surface()->client()->lastCursorRequest());
         }
@@ -498,25 +649,12 @@ void Pointer::pointerMoveEvent(const LPointerMoveEvent& event){
 
     // 以下代码: 只要是移动光标, 就更新下一个插入目标
     TileyWindowStateManager& manager = TileyWindowStateManager::getInstance();
-    // 更新目标容器
-    LSurface* targetInsertWindowSurface = surfaceAtWithFilter(cursor()->pos(), [&manager](LSurface* surface){
-        // 排除不是窗口的surface
-        if(!surface->toplevel()){
-            return false;
-        }
-
-        ToplevelRole* window = static_cast<ToplevelRole*>(surface->toplevel());
-
-        // 排除不是平铺的surface
-        if(!manager.isTiledWindow(window)){
-            return false;
-        }
-
-        return true;
-    });
+    // 一次命中测试, 插入目标和焦点共用
+    const PointerHit hit = hitTest(cursor()->pos());
 
-    Surface* _targetInsertWindowSurface = static_cast<Surface*>(targetInsertWindowSurface);
-    if(_targetInsertWindowSurface && manager.activateContainer() != _targetInsertWindowSurface->tl()->container){
+    // 更新目标容器
+    Surface* _targetInsertWindowSurface = static_cast<Surface*>(hit.tiledWindow);
+    if(_targetInsertWindowSurface && manager.activatedContainer() != _targetInsertWindowSurface->tl()->container){
         manager.setActiveContainer(_targetInsertWindowSurface->tl()->container);
         LLog::debug("已将插入活动目标更新为鼠标处的平铺窗口");
     }
@@ -547,11 +685,13 @@ void Pointer::pointerMoveEvent(const LPointerMoveEvent& event){
                 LLog::debug("调整平铺容器大小");
                 if(manager.resizeTile(cursor()->pos())){
                     manager.reapplyWindowState(targetWindow);
-                    manager.recalculate();
+                    manager.scheduleRecalculate();
                 }
             }else{
                 // 不是平铺层的, 直接更新调整的位置
                 session->updateDragPoint(cursor()->pos());
+                manager.markStateChanged();
+                SurfaceIndex::invalidateAll();
             }
         }
         
@@ -577,6 +717,8 @@ void Pointer::pointerMoveEvent(const LPointerMoveEvent& event){
             // 更新拖拽窗口的位置
             activeMoving = true;
             session->updateDragPoint(cursor()->pos());
+            manager.markStateChanged();
+            SurfaceIndex::invalidateAll();
             // 立即刷新屏幕, 确保视觉跟上
             session->toplevel()->surface()->repaintOutputs();
             
@@ -604,20 +746,7 @@ void Pointer::pointerMoveEvent(const LPointerMoveEvent& event){
     // 从这里开始, 才是正常的鼠标移动逻辑(前面的都是特殊情况处理)
  
     // 查找光标下的第一个正在被显示的surface
-    LSurface *surface { pointerConstrained ? focus() : surfaceAtWithFilter(cursor()->pos(), 
-        [this](LSurface* s) -> bool{
-            auto surface = static_cast<Surface*>(s);
-            if(!surface || !surface->getView()){
-                return false;
-            }
-
-            if(!surface->getView()->visible()){
-                return false;
-            }
-            
-            return true;
-        })
-    };
+    LSurface *surface { pointerConstrained ? focus() : hit.focusable };
  
     if (surface)
     {   
@@ -4,21 +4,76 @@
 #include "LPointerMoveEvent.h"
 #include <LPointer.h>
 
-#include <functional>
+#include "src/lib/input/SurfaceIndex.hpp"
+#include "src/test/TraceZone.hpp"
+
+#include <optional>
 
 using namespace Louvre;
 
 namespace tiley{
+
+    // Result of the single hit-test done for a pointer position, shared by every consumer of a pointer move
+    struct PointerHit{
+        // top-most surface accepting input
+        LSurface* surface = nullptr;
+        // top-most surface whose view is visible: receives pointer focus
+        LSurface* focusable = nullptr;
+        // top-most visible tiled window: next insertion target
+        LSurface* tiledWindow = nullptr;
+    };
+
     class Pointer final : public Louvre::LPointer{
         public:
             using LPointer::LPointer;
             void pointerButtonEvent(const LPointerButtonEvent& event) override;
             void pointerMoveEvent(const LPointerMoveEvent& event) override;
+            // other events act at the cursor position: batched motion is resolved first
+            void pointerScrollEvent(const LPointerScrollEvent& event) override;
+            void pointerSwipeBeginEvent(const LPointerSwipeBeginEvent& event) override;
+            void pointerSwipeUpdateEvent(const LPointerSwipeUpdateEvent& event) override;
+            void pointerSwipeEndEvent(const LPointerSwipeEndEvent& event) override;
+            void pointerPinchBeginEvent(const LPointerPinchBeginEvent& event) override;
+            void pointerPinchUpdateEvent(const LPointerPinchUpdateEvent& event) override;
+            void pointerPinchEndEvent(const LPointerPinchEndEvent& event) override;
+            void pointerHoldBeginEvent(const LPointerHoldBeginEvent& event) override;
+            void pointerHoldEndEvent(const LPointerHoldEndEvent& event) override;
+            // flushPendingMotion: process motion batched since the last frame. Called by outputs right before painting.
+            void flushPendingMotion();
+            // hitTest: surfaces under `point`, computed once per position and surface index generation
+            const PointerHit& hitTest(const LPointF& point);
             void focusChanged() override;
             void printPointerPressedSurfaceDebugInfo();
             bool processCompositorKeybind(const LPointerButtonEvent& event);
             void processPointerButtonEvent(const LPointerButtonEvent& event);
 
-            LSurface* surfaceAtWithFilter(const LPoint& point, const std::function<bool (LSurface*)> &filter);
+            // surfaceAtWithFilter: top-most surface at `point` accepted by `filter(LSurface*)`, looked up in the index of the output under `point`
+            template<typename Filter>
+            LSurface* surfaceAtWithFilter(const LPoint& point, Filter&& filter){
+                TILEY_TRACE_ZONE("Pointer::surfaceAtWithFilter");
+                const SurfaceIndex* index = surfaceIndexAt(point);
+                return index ? index->surfaceAt(point, filter) : nullptr;
+            }
+
+        private:
+            // processPointerMoveEvent: move the cursor and dispatch focus/motion for one(possibly batched) event
+            void processPointerMoveEvent(const LPointerMoveEvent& event);
+
+            // frame-rate-capped motion(`TILEY_POINTER_FRAME_CAP=1`): raw deltas are summed and resolved once per frame
+            bool m_motionFrameCap = motionFrameCapRequested();
+            std::optional<LPointerMoveEvent> m_pendingMotion;
+            static bool motionFrameCapRequested();
+
+            // output the cursor was on after the last motion, only compared
+            const LOutput* m_cursorOutput = nullptr;
+
+            // cache of the last hit-test
+            PointerHit m_lastHit;
+            LPoint m_lastHitPoint;
+            const SurfaceIndex* m_lastHitIndex = nullptr;
+            UInt64 m_lastHitGeneration = 0;
+
+            // surfaceIndexAt: up to date surface index of the output containing `point`, nullptr if no output contains it
+            const SurfaceIndex* surfaceIndexAt(const LPoint& point);
     };
 }
\ No newline at end of file
@@ -10,8 +10,26 @@
 #include <LKeyboard.h>
 #include <xkbcommon/xkbcommon.h>
 
+#include "src/lib/TileyWindowStateManager.hpp"
+#include "src/lib/input/SurfaceIndex.hpp"
+#include "src/lib/ipc/IPCManager.hpp"
+
 using namespace tiley;
 
+void Seat::outputPlugged(LOutput* output){
+    LSeat::outputPlugged(output);
+    SurfaceIndex::invalidateAll();
+    TileyWindowStateManager::getInstance().markStateChanged();
+    IPCManager::getInstance().broadcastOutputEvent();
+}
+
+void Seat::outputUnplugged(LOutput* output){
+    LSeat::outputUnplugged(output);
+    SurfaceIndex::invalidateAll();
+    TileyWindowStateManager::getInstance().markStateChanged();
+    IPCManager::getInstance().broadcastOutputEvent();
+}
+
 void Seat::configureInputDevices() noexcept{
     if(compositor()->inputBackendId() != LInputBackendLibinput){   //如果输入后端不是libinput, 则终止。说明此时非常有可能运行在wayland嵌套模式下, 由父合成器提供输入设备。
         return;
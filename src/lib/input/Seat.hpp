@@ -11,6 +11,8 @@ namespace tiley{
             using LSeat::LSeat;
             void configureInputDevices() noexcept;
             bool eventFilter(LEvent& event) override;
+            void outputPlugged(LOutput* output) override;
+            void outputUnplugged(LOutput* output) override;
     };
 }
 
@@ -17,6 +17,7 @@
 
 #include "src/lib/TileyWindowStateManager.hpp"
 #include "src/lib/Utils.hpp"
+#include "src/lib/ipc/IPCManager.hpp"
 
 using json = nlohmann::json;
 using namespace tiley;
@@ -73,33 +74,37 @@ void ShortcutManager::initializeHandlers(){
         const bool L_ALT   { seat()->keyboard()->isKeyCodePressed(KEY_LEFTALT)   };
         const bool mods    { L_ALT || L_SHIFT || L_CTRL || R_CTRL };
         if(!mods){
-            LLauncher::launch("weston-terminal");
+            return LLauncher::launch("weston-terminal") > 0;
         }
+        return false;
     });
-    registerHandler("launch_app_launcher",[](auto){ LLog::log("执行: launch_app_launcher"); });
-    registerHandler("change_wallpaper",   [](auto){ LLog::log("执行: change_wallpaper"); });
+    registerHandler("launch_app_launcher",[](auto){ LLog::log("执行: launch_app_launcher"); return false; });
+    registerHandler("change_wallpaper",   [](auto){ LLog::log("执行: change_wallpaper"); return false; });
     registerHandler("toggle_floating", [&windowStateManager](auto){
         LLog::debug("执行: toggle_floating");
         Louvre::LSurface* surface = seat()->pointer()->surfaceAt(cursor()->pos());
         if(surface){
             Surface* targetSurface = static_cast<Surface*>(surface);
             if(targetSurface->tl()){
-                windowStateManager.toggleStackWindow(targetSurface->tl());
+                return windowStateManager.toggleStackWindow(targetSurface->tl());
             }
         }
+        return false;
     });
     registerHandler("close_window", [](auto){
         LLog::log("执行: close_window");
         if (seat()->keyboard()->focus()){
             seat()->keyboard()->focus()->client()->destroyLater();
+            return true;
         }
+        return false;
     });
     registerHandler("screenshot",[](auto){
         if (cursor()->output() && cursor()->output()->bufferTexture(0)){
             std::filesystem::path path { getenvString("HOME") };
 
             if (path.empty())
-                return;
+                return false;
 
             path /= "Desktop/Louvre_Screenshoot_";
 
@@ -110,15 +115,18 @@ void ShortcutManager::initializeHandlers(){
 
             path += timeString;
 
-            cursor()->output()->bufferTexture(0)->save(path);
+            return cursor()->output()->bufferTexture(0)->save(path);
         }
+        return false;
     });
     registerWorkspacesHandler();
     registerHandler("quit_compositor", [](auto){
         compositor()->finish();
+        return true;
     });
     registerHandler("change_wallpaper", [](auto){
         WallpaperManager::getInstance().selectAndSetNewWallpaper();
+        return true;
     });
     LLog::debug("快捷键系统初始化完成（模块化）");
 }
@@ -129,52 +137,52 @@ void ShortcutManager::registerWorkspacesHandler(){
     // 注册工作区切换,理论上可以注册最大工作区的数量呢
     registerHandler("goto_ws_1", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_1");
-        windowStateManager.switchWorkspace(0);
+        return windowStateManager.switchWorkspace(0);
     });
 
     registerHandler("goto_ws_2", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_2"); 
-        windowStateManager.switchWorkspace(1);
+        return windowStateManager.switchWorkspace(1);
     });
     
     registerHandler("goto_ws_3", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_3"); 
-        windowStateManager.switchWorkspace(2);
+        return windowStateManager.switchWorkspace(2);
     });
     
     registerHandler("goto_ws_4", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_4"); 
-        windowStateManager.switchWorkspace(3);
+        return windowStateManager.switchWorkspace(3);
     });
     
     registerHandler("goto_ws_5", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_5"); 
-        windowStateManager.switchWorkspace(4);
+        return windowStateManager.switchWorkspace(4);
     });
     
     registerHandler("goto_ws_6", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_6"); 
-        windowStateManager.switchWorkspace(5);
+        return windowStateManager.switchWorkspace(5);
     });
     
     registerHandler("goto_ws_7", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_7"); 
-        windowStateManager.switchWorkspace(6);
+        return windowStateManager.switchWorkspace(6);
     });
     
     registerHandler("goto_ws_8", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_8"); 
-        windowStateManager.switchWorkspace(7);
+        return windowStateManager.switchWorkspace(7);
     });
     
     registerHandler("goto_ws_9", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_9"); 
-        windowStateManager.switchWorkspace(8);
+        return windowStateManager.switchWorkspace(8);
     });
     
     registerHandler("goto_ws_10", [&windowStateManager](auto){ 
         LLog::log("执行: goto_ws_10"); 
-        windowStateManager.switchWorkspace(9);
+        return windowStateManager.switchWorkspace(9);
     });
 }
 
@@ -196,10 +204,12 @@ bool ShortcutManager::tryDispatch(const std::string& combo){
     auto it = comboToAction_.find(combo);
     if (it == comboToAction_.end())
         return false;
-    const std::string& actionName = it->second;
+    // copied: the handler may reload the shortcut maps
+    const std::string actionName = it->second;
     auto hit = handlers_.find(actionName);
     if (hit != handlers_.end()){
         hit->second(combo);
+        IPCManager::getInstance().broadcastBindingEvent(actionName, combo);
     } else {
         //LLog::warning("快捷键动作未注册: %s (combo=%s)", actionName.c_str(), combo.c_str());
         return false;  //未注册则不命中
@@ -207,6 +217,18 @@ bool ShortcutManager::tryDispatch(const std::string& combo){
     return true;
 }
 
+bool ShortcutManager::runAction(const std::string& actionName){
+    auto hit = handlers_.find(actionName);
+    if (hit == handlers_.end())
+        return false;
+    // 没有对应的按键组合
+    return hit->second("");
+}
+
+bool ShortcutManager::hasAction(const std::string& actionName) const{
+    return handlers_.find(actionName) != handlers_.end();
+}
+
 //规范化并拼接
 std::string ShortcutManager::normalizeCombo(const std::string& raw){
     std::string lower;
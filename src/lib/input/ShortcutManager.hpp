@@ -9,7 +9,8 @@
 
 namespace tiley {
 
-    using ShortcutHandler = std::function<void(const std::string& combo)>;
+    // returns whether the action did something(e.g. false when switching to a workspace while a switch is running)
+    using ShortcutHandler = std::function<bool(const std::string& combo)>;
     /// 负责快捷键映射加载 / 规范化 / 热重载 / 分发
     class ShortcutManager {
         public:
@@ -24,6 +25,12 @@ namespace tiley {
             /// 试着调度 combo（规范化后的）,命中则执行并返回 true
             bool tryDispatch(const std::string& combo);
 
+            /// 按名字直接执行 action（IPC 命令使用）,返回 handler 的执行结果, 未注册返回 false
+            bool runAction(const std::string& actionName);
+
+            /// 是否注册了这个 action
+            bool hasAction(const std::string& actionName) const;
+
             /// 规范化 raw combo,比如 "Ctrl+Shift+T" -> "ctrl+shift+t"
             static std::string normalizeCombo(const std::string& raw);
 
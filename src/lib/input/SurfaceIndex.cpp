@@ -0,0 +1,75 @@
+#include "SurfaceIndex.hpp"
+
+#include <LCompositor.h>
+
+#include <algorithm>
+
+using namespace tiley;
+
+void SurfaceIndex::rebuild(const LRect& area){
+
+    m_generation = s_generation;
+    m_area = area;
+    m_entries.clear();
+    m_unplaced.clear();
+
+    if(area.w() <= 0 || area.h() <= 0){
+        m_cells.clear();
+        m_columns = m_rows = 0;
+        return;
+    }
+
+    m_columns = (UInt32)((area.w() + CELL_SIZE - 1) / CELL_SIZE);
+    m_rows = (UInt32)((area.h() + CELL_SIZE - 1) / CELL_SIZE);
+
+    // keep the capacity of cells between rebuilds
+    m_cells.resize(m_columns * m_rows);
+    for(auto& cell : m_cells){
+        cell.clear();
+    }
+
+    const Int32 areaRight = area.x() + area.w();
+    const Int32 areaBottom = area.y() + area.h();
+
+    // surfaces are ordered bottom to top, walk them backwards so that cells list the top-most first
+    const auto& surfaces = compositor()->surfaces();
+    for(auto it = surfaces.rbegin(); it != surfaces.rend(); ++it){
+        LSurface* s = *it;
+
+        if(!s->mapped() || s->minimized()){
+            continue;
+        }
+
+        // may be anywhere by the time of a lookup
+        if(!s->toplevel()){
+            m_unplaced.push_back((UInt32)m_entries.size());
+            m_entries.push_back(s);
+            continue;
+        }
+
+        const LRect bounds(s->rolePos(), s->size());
+
+        const Int32 left = std::max(bounds.x(), area.x());
+        const Int32 top = std::max(bounds.y(), area.y());
+        const Int32 right = std::min(bounds.x() + bounds.w(), areaRight);
+        const Int32 bottom = std::min(bounds.y() + bounds.h(), areaBottom);
+
+        if(left >= right || top >= bottom){
+            continue;
+        }
+
+        const UInt32 entryIndex = (UInt32)m_entries.size();
+        m_entries.push_back(s);
+
+        const UInt32 firstColumn = (UInt32)((left - area.x()) / CELL_SIZE);
+        const UInt32 lastColumn = (UInt32)((right - 1 - area.x()) / CELL_SIZE);
+        const UInt32 firstRow = (UInt32)((top - area.y()) / CELL_SIZE);
+        const UInt32 lastRow = (UInt32)((bottom - 1 - area.y()) / CELL_SIZE);
+
+        for(UInt32 row = firstRow; row <= lastRow; row++){
+            for(UInt32 column = firstColumn; column <= lastColumn; column++){
+                m_cells[row * m_columns + column].push_back(entryIndex);
+            }
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <LNamespaces.h>
+#include <LRect.h>
+#include <LPoint.h>
+#include <LSurface.h>
+#include <LRegion.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace Louvre;
+
+namespace tiley{
+
+    // A uniform grid of mapped surfaces covering one output, used for pointer hit-testing.
+    // Every cell lists the surfaces overlapping it from top-most to bottom-most, so a lookup only tests
+    // the few surfaces near the point instead of every surface of the compositor.
+    // Indexes are rebuilt lazily: anything changing the mapping, stacking or placement of surfaces calls `invalidateAll`.
+    // Only toplevels, placed by tiley, are put in cells. Surfaces placed by clients or Louvre(subsurfaces, popups,
+    // layer surfaces...) can move without tiley knowing, they are few and tested at every lookup instead.
+    // Bounds are always read live, never cached.
+    class SurfaceIndex{
+        public:
+            // rebuild: index mapped surfaces intersecting `area`
+            void rebuild(const LRect& area);
+
+            // stale: surfaces changed since the last rebuild
+            inline bool stale() const { return m_generation != s_generation; }
+
+            // invalidateAll: mark indexes of all outputs stale
+            static inline void invalidateAll(){ s_generation++; }
+
+            // forEachAt: visit surfaces accepting input at `point` from top-most to bottom-most until `visitor(LSurface*)` returns true.
+            // `visitor` is inlined for every candidate, no type erasure involved.
+            template<typename Visitor>
+            void forEachAt(const LPoint& point, Visitor&& visitor) const{
+                if(!m_area.containsPoint(point) || m_cells.empty()){
+                    return;
+                }
+
+                // containsPoint includes the right and bottom edges, which belong to the last column/row
+                const UInt32 column = std::min((UInt32)((point.x() - m_area.x()) / CELL_SIZE), m_columns - 1);
+                const UInt32 row = std::min((UInt32)((point.y() - m_area.y()) / CELL_SIZE), m_rows - 1);
+                const std::vector<UInt32>& cell = m_cells[row * m_columns + column];
+
+                // both lists are sorted top-most first, merge them to keep the stacking order
+                size_t cellPos = 0, unplacedPos = 0;
+                while(cellPos < cell.size() || unplacedPos < m_unplaced.size()){
+                    UInt32 entryIndex;
+                    if(unplacedPos >= m_unplaced.size() || (cellPos < cell.size() && cell[cellPos] < m_unplaced[unplacedPos])){
+                        entryIndex = cell[cellPos++];
+                    }else{
+                        entryIndex = m_unplaced[unplacedPos++];
+                    }
+
+                    LSurface* s = m_entries[entryIndex];
+                    if(!s->mapped() || s->minimized()){
+                        continue;
+                    }
+
+                    const LPoint pos = s->rolePos();
+                    if(!LRect(pos, s->size()).containsPoint(point)){
+                        continue;
+                    }
+
+                    if(s->inputRegion().containsPoint(point - pos) && visitor(s)){
+                        return;
+                    }
+                }
+            }
+
+            // surfaceAt: top-most surface accepting input at `point` for which `filter(LSurface*)` returns true
+            template<typename Filter>
+            LSurface* surfaceAt(const LPoint& point, Filter&& filter) const{
+                LSurface* result = nullptr;
+                forEachAt(point, [&](LSurface* s){
+                    if(filter(s)){
+                        result = s;
+                        return true;
+                    }
+                    return false;
+                });
+                return result;
+            }
+
+            // generation: changes every time the index is rebuilt
+            inline UInt64 generation() const { return m_generation; }
+
+        private:
+            static constexpr Int32 CELL_SIZE = 128;
+
+            LRect m_area;
+            UInt32 m_columns = 0;
+            UInt32 m_rows = 0;
+            // top-most first
+            std::vector<LSurface*> m_entries;
+            // indices of `m_entries` overlapping every cell, row major
+            std::vector<std::vector<UInt32>> m_cells;
+            // indices of `m_entries` not placed by tiley, tested for every point
+            std::vector<UInt32> m_unplaced;
+
+            UInt64 m_generation = 0;
+            static inline UInt64 s_generation = 1;
+    };
+}
@@ -1,16 +1,32 @@
 #include "IPCManager.hpp"
 #include "src/lib/TileyWindowStateManager.hpp"
+#include "src/lib/client/ToplevelRole.hpp"
+#include "src/lib/core/Container.hpp"
+#include "src/lib/input/ShortcutManager.hpp"
+#include "src/lib/output/Output.hpp"
+#include "src/test/PerfmonRegistry.hpp"
+#include "src/test/PerfmonSink.hpp"
+#include "src/test/TraceZone.hpp"
 #include "LCompositor.h"
+#include "LCursor.h"
+#include "LKeyboard.h"
+#include "LLauncher.h"
 #include "LLog.h"
+#include "LSeat.h"
+#include "LSurface.h"
 
 #include <nlohmann/json.hpp>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
+#include <sstream>
 
 using json = nlohmann::json;
 using namespace tiley;
@@ -19,12 +35,31 @@ using namespace Louvre;
 std::unique_ptr<IPCManager, IPCManager::IPCManagerDeleter> IPCManager::INSTANCE = nullptr;
 std::once_flag IPCManager::onceFlag;
 
+constexpr UInt32 IPC_COMMAND = 0;
 constexpr UInt32 IPC_GET_WORKSPACES = 1;
 constexpr UInt32 IPC_SUBSCRIBE = 2;
 constexpr UInt32 IPC_GET_OUTPUTS = 3;
 constexpr UInt32 IPC_GET_TREE = 4;
 constexpr UInt32 IPC_REPLY_SUBSCRIBE = 2;
 constexpr UInt32 IPC_EVENT_WORKSPACE = 0 | (1 << 31);
+constexpr UInt32 IPC_EVENT_OUTPUT = 1 | (1 << 31);
+constexpr UInt32 IPC_EVENT_WINDOW = 3 | (1 << 31);
+constexpr UInt32 IPC_EVENT_BINDING = 5 | (1 << 31);
+constexpr UInt32 IPC_EVENT_SHUTDOWN = 6 | (1 << 31);
+// tiley extensions, outside of the range used by sway
+constexpr UInt32 IPC_TILEY_PERFMON = 200;
+constexpr UInt32 IPC_EVENT_PERFMON = 200 | (1 << 31);
+
+// frame: "i3-ipc", payload length and type(native endianness), payload
+constexpr size_t IPC_HEADER_SIZE = 14;
+constexpr uint32_t IPC_MAX_PAYLOAD = 65536;
+// inbox size on the first read, grown to fit the largest frame received(at most IPC_HEADER_SIZE + IPC_MAX_PAYLOAD)
+constexpr size_t IPC_INBOX_INITIAL_CAPACITY = 4096;
+
+// a client not reading this much is dropped instead of growing its queue forever
+constexpr size_t IPC_OUTBOX_HIGH_WATER = 4 * 1024 * 1024;
+// packets handed to the socket per system call
+constexpr int IPC_MAX_IOVECS = 16;
 
 IPCManager::IPCManager() : m_socket_fd(-1), m_listen_event_source(nullptr) {}
 
@@ -33,6 +68,10 @@ IPCManager::~IPCManager() {
         wl_event_source_remove(m_listen_event_source);
     }
 
+    if (m_perfmon_event_source) {
+        wl_event_source_remove(m_perfmon_event_source);
+    }
+
     if (m_socket_fd >= 0) {
         close(m_socket_fd);
         const char* xdg_runtime = getenv("XDG_RUNTIME_DIR");
@@ -41,15 +80,16 @@ IPCManager::~IPCManager() {
         unlink(socket_path.c_str());
     }
 
-    for (auto& client : m_clients) {
-        if (client.read_event_source) {
-            wl_event_source_remove(client.read_event_source);
+    for (IPCClient* client : m_clients) {
+        if (client->event_source) {
+            wl_event_source_remove(client->event_source);
         }
-        if (client.fd >= 0) {
-            close(client.fd);
+        if (client->fd >= 0) {
+            close(client->fd);
         }
     }
     m_clients.clear();
+    m_client_slots.clear();
 }
 
 IPCManager& IPCManager::getInstance() {
@@ -64,7 +104,7 @@ std::string IPCManager::createIPCPacket(uint32_t type, const std::string& payloa
     uint32_t payload_length = payload.length();
     
     std::string packet;
-    packet.reserve(14 + payload_length);
+    packet.reserve(IPC_HEADER_SIZE + payload_length);
     packet.append(magic, 6);
     packet.append(reinterpret_cast<const char*>(&payload_length), 4);
     packet.append(reinterpret_cast<const char*>(&type), 4);
@@ -72,11 +112,37 @@ std::string IPCManager::createIPCPacket(uint32_t type, const std::string& payloa
     return packet;
 }
 
+static json rectToJson(const LRect& rect) {
+    return {{"x", rect.x()}, {"y", rect.y()}, {"width", rect.w()}, {"height", rect.h()}};
+}
+
+static json rectToJson(const LayoutRect& rect) {
+    return {{"x", rect.x}, {"y", rect.y}, {"width", rect.w}, {"height", rect.h}};
+}
+
+static std::string outputName(LOutput* output) {
+    if (!output) {
+        return "";
+    }
+    return output->name() ? output->name() : "output-" + std::to_string(output->id());
+}
+
+static bool isFocusedOutput(LOutput* output) {
+    return output && output == cursor()->output();
+}
+
+// ids only have to be unique and stable while the node lives
+static uint64_t nodeId(const void* node) {
+    return reinterpret_cast<uintptr_t>(node);
+}
+
 json createWorkspaceList(UInt32 currentWorkspace, UInt32 totalWorkspaces) {
+    auto& manager = TileyWindowStateManager::getInstance();
     json workspaces = json::array();
     for (UInt32 i = 0; i < totalWorkspaces; ++i) {
         bool is_focused = (i == currentWorkspace);
         UInt32 workspace_num = i + 1;
+        Output* output = manager.workspaceOutput(i);
         workspaces.push_back({
             {"id", i},
             {"num", workspace_num},
@@ -84,8 +150,8 @@ json createWorkspaceList(UInt32 currentWorkspace, UInt32 totalWorkspaces) {
             {"visible", is_focused},
             {"focused", is_focused},
             {"urgent", false},
-            {"rect", {{"x", 0}, {"y", 0}, {"width", 1920}, {"height", 1080}}},
-            {"output", "eDP-1"}
+            {"rect", output ? rectToJson(output->availableGeometry()) : rectToJson(LRect())},
+            {"output", outputName(output)}
         });
     }
     return workspaces;
@@ -107,6 +173,180 @@ json createWorkspaceEvent(UInt32 currentWorkspace, UInt32 totalWorkspaces) {
     };
 }
 
+json createOutputList() {
+    auto& manager = TileyWindowStateManager::getInstance();
+    // LTransform follows wl_output_transform
+    static const char* transforms[] = {"normal", "90", "180", "270", "flipped", "flipped-90", "flipped-180", "flipped-270"};
+
+    json outputs = json::array();
+    for (LOutput* output : compositor()->outputs()) {
+        const int transform = static_cast<int>(output->transform());
+        outputs.push_back({
+            {"name", outputName(output)},
+            {"make", output->manufacturer() ? output->manufacturer() : "Unknown"},
+            {"model", output->model() ? output->model() : "Unknown"},
+            {"serial", "Unknown"},
+            {"active", true},
+            {"primary", output == compositor()->outputs().front()},
+            {"focused", isFocusedOutput(output)},
+            {"scale", output->scale()},
+            {"subpixel_hinting", "rgb"},
+            {"transform", transform >= 0 && transform < 8 ? transforms[transform] : "normal"},
+            {"rect", rectToJson(LRect(output->pos(), output->size()))},
+            {"current_workspace", std::to_string(manager.currentWorkspace() + 1)}
+        });
+    }
+    return outputs;
+}
+
+static json createWindowNode(ToplevelRole* window, const LRect& rect, bool focused) {
+    return {
+        {"id", nodeId(window)},
+        {"type", "con"},
+        {"name", window->title()},
+        {"app_id", window->appId()},
+        {"layout", "none"},
+        {"focused", focused},
+        {"rect", rectToJson(rect)},
+        {"nodes", json::array()},
+        {"floating_nodes", json::array()}
+    };
+}
+
+static json createContainerNode(LayoutNode* node, Container* focused) {
+    if (node->isLeaf()) {
+        Container* container = static_cast<Container*>(node);
+        auto* window = static_cast<ToplevelRole*>(container->getWindow());
+        if (!window) {
+            return nullptr;
+        }
+        return createWindowNode(window, container->getGeometry(), container == focused);
+    }
+
+    json nodes = json::array();
+    for (LayoutNode* child : {node->child1(), node->child2()}) {
+        if (!child) {
+            continue;
+        }
+        json childNode = createContainerNode(child, focused);
+        if (!childNode.is_null()) {
+            nodes.push_back(std::move(childNode));
+        }
+    }
+
+    return {
+        {"id", nodeId(node)},
+        {"type", "con"},
+        {"name", nullptr},
+        {"layout", node->splitType() == SPLIT_H ? "splith" : "splitv"},
+        {"split_ratio", node->splitRatio()},
+        {"focused", false},
+        {"rect", rectToJson(node->geometry())},
+        {"nodes", std::move(nodes)},
+        {"floating_nodes", json::array()}
+    };
+}
+
+static json createWorkspaceNode(UInt32 workspace, bool focused, Output* output) {
+    auto& manager = TileyWindowStateManager::getInstance();
+    Container* focusedContainer = manager.activatedContainer();
+
+    // the root of a workspace only has one child taking the whole area, it is the workspace node itself
+    json nodes = json::array();
+    LayoutNode* root = manager.workspaceRoot(workspace);
+    if (root && root->child1()) {
+        json child = createContainerNode(root->child1(), focusedContainer);
+        if (!child.is_null()) {
+            nodes.push_back(std::move(child));
+        }
+    }
+
+    json floatingNodes = json::array();
+    for (LSurface* surface : compositor()->surfaces()) {
+        if (!surface->mapped() || !surface->toplevel()) {
+            continue;
+        }
+        auto* window = static_cast<ToplevelRole*>(surface->toplevel());
+        if (window->workspaceId == workspace && !manager.isTiledWindow(window)) {
+            floatingNodes.push_back(createWindowNode(window, LRect(surface->pos(), surface->size()),
+                                                     focused && surface == seat()->keyboard()->focus()));
+        }
+    }
+
+    const UInt32 workspace_num = workspace + 1;
+    return {
+        {"id", nodeId(root)},
+        {"type", "workspace"},
+        {"num", workspace_num},
+        {"name", std::to_string(workspace_num)},
+        {"focused", focused},
+        {"visible", focused},
+        {"layout", "splith"},
+        {"output", outputName(output)},
+        {"rect", output ? rectToJson(output->availableGeometry()) : rectToJson(LRect())},
+        {"nodes", std::move(nodes)},
+        {"floating_nodes", std::move(floatingNodes)}
+    };
+}
+
+json createTree() {
+    auto& manager = TileyWindowStateManager::getInstance();
+    const UInt32 current = manager.currentWorkspace();
+
+    // workspaces exist while they have windows, the current one always does
+    std::vector<std::pair<UInt32, Output*>> workspaces;
+    for (UInt32 i = 0; i < (UInt32)manager.WORKSPACES; ++i) {
+        LayoutNode* root = manager.workspaceRoot(i);
+        bool populated = root && root->child1();
+        if (!populated) {
+            for (LSurface* surface : compositor()->surfaces()) {
+                if (surface->mapped() && surface->toplevel() && static_cast<ToplevelRole*>(surface->toplevel())->workspaceId == i) {
+                    populated = true;
+                    break;
+                }
+            }
+        }
+        if (populated || i == current) {
+            workspaces.emplace_back(i, manager.workspaceOutput(i));
+        }
+    }
+
+    json outputs = json::array();
+    for (LOutput* output : compositor()->outputs()) {
+        json nodes = json::array();
+        for (const auto& [workspace, workspaceOutput] : workspaces) {
+            if (workspaceOutput == output) {
+                nodes.push_back(createWorkspaceNode(workspace, workspace == current, workspaceOutput));
+            }
+        }
+        outputs.push_back({
+            {"id", nodeId(output)},
+            {"type", "output"},
+            {"name", outputName(output)},
+            {"focused", isFocusedOutput(output)},
+            {"rect", rectToJson(LRect(output->pos(), output->size()))},
+            {"current_workspace", std::to_string(current + 1)},
+            {"nodes", std::move(nodes)},
+            {"floating_nodes", json::array()}
+        });
+    }
+
+    LRect bounds;
+    for (LOutput* output : compositor()->outputs()) {
+        bounds.setW(std::max(bounds.w(), output->pos().x() + output->size().w()));
+        bounds.setH(std::max(bounds.h(), output->pos().y() + output->size().h()));
+    }
+
+    return {
+        {"id", 1},
+        {"type", "root"},
+        {"name", "root"},
+        {"rect", rectToJson(bounds)},
+        {"nodes", std::move(outputs)},
+        {"floating_nodes", json::array()}
+    };
+}
+
 void IPCManager::initialize() {
     m_socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (m_socket_fd < 0) {
@@ -158,6 +398,22 @@ void IPCManager::initialize() {
         LLog::fatal("[IPCManager]: Unable to initialize socket connection eventloop");
         close(m_socket_fd);
         m_socket_fd = -1;
+        return;
+    }
+
+    // perfmon reports are produced by the perfmon flusher thread and streamed from here
+    int perfmon_fd = perfmonStreamFd();
+    if (perfmon_fd >= 0) {
+        m_perfmon_event_source = wl_event_loop_add_fd(
+            compositor()->eventLoop(),
+            perfmon_fd,
+            WL_EVENT_READABLE,
+            &IPCManager::handlePerfmonStream,
+            this
+        );
+    }
+    if (!m_perfmon_event_source) {
+        LLog::warning("[IPCManager]: Unable to watch perfmon reports, the perfmon event will not be emitted");
     }
 }
 
@@ -175,88 +431,143 @@ int IPCManager::handleNewConnection(int fd, uint32_t mask, void *data) {
     int flags = fcntl(client_fd, F_GETFL, 0);
     fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
     
-    IPCClient& client = self->m_clients.emplace_back();
-    client.fd = client_fd;
-    client.subscribed_to_workspace = false;
+    IPCClient& client = self->registerClient(client_fd);
     
-    client.read_event_source = wl_event_loop_add_fd(
+    client.event_source = wl_event_loop_add_fd(
         compositor()->eventLoop(),
         client_fd,
         WL_EVENT_READABLE,
         &IPCManager::handleClientMessage,
-        self
+        &client
     );
     
-    if (!client.read_event_source) {
+    if (!client.event_source) {
         LLog::error("[IPCManager]: Unable to register client socket to wayland");
         close(client_fd);
-        self->m_clients.pop_back();
+        client.fd = -1;
+        self->eraseClient(client);
     }
     return 0;
 }
 
 int IPCManager::handleClientMessage(int fd, uint32_t mask, void *data) {
-    L_UNUSED(mask);
-    IPCManager* self = static_cast<IPCManager*>(data);
-    
-    auto it = std::find_if(self->m_clients.begin(), self->m_clients.end(),
-                          [fd](const IPCClient& client) { return client.fd == fd; });
-    
-    if (it == self->m_clients.end()) {
-        return 0;
-    }
-    
-    IPCClient& client = *it;
-    char header[14];
-    ssize_t header_bytes = recv(fd, header, 14, MSG_PEEK);
-    
-    if (header_bytes <= 0) {
+    TILEY_TRACE_ZONE("IPCManager::handleClientMessage");
+    L_UNUSED(fd);
+    IPCManager* self = &getInstance();
+    // the event source is removed before the client is destroyed, and the loop skips removed sources of a dispatch batch
+    IPCClient& client = *static_cast<IPCClient*>(data);
+    self->m_dispatching = &client;
+
+    if (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR)) {
         self->disconnectClient(client);
-        return 0;
-    }
-    
-    if (header_bytes < 14) {
-        return 0;
+    } else {
+        // the client is reading again, continue with what it left
+        if (mask & WL_EVENT_WRITABLE) {
+            self->flushOutbox(client);
+        }
+        if ((mask & WL_EVENT_READABLE) && client.fd >= 0) {
+            self->readFrames(client);
+        }
     }
-    
-    if (memcmp(header, "i3-ipc", 6) != 0) {
-        self->disconnectClient(client);
-        return 0;
+
+    self->m_dispatching = nullptr;
+    if (client.fd < 0) {
+        self->eraseClient(client);
     }
-    
-    ssize_t actual_read = recv(fd, header, 14, 0);
-    if (actual_read != 14) {
-        self->disconnectClient(client);
-        return 0;
+    return 0;
+}
+
+void IPCManager::readFrames(IPCClient& client) {
+    if (client.inbox.empty()) {
+        client.inbox.resize(IPC_INBOX_INITIAL_CAPACITY);
     }
-    
-    uint32_t length, type;
-    memcpy(&length, header + 6, 4);
-    memcpy(&type, header + 10, 4);
 
-    if (length > 65536) {
-        self->disconnectClient(client);
-        return 0;
+    while (client.fd >= 0) {
+        const size_t space = client.inbox.size() - client.inbox_end;
+        ssize_t received = recv(client.fd, client.inbox.data() + client.inbox_end, space, 0);
+
+        if (received == 0) {
+            disconnectClient(client);
+            return;
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                disconnectClient(client);
+            }
+            return;
+        }
+
+        client.inbox_end += received;
+        if (!parseFrames(client)) {
+            return;
+        }
+
+        // the socket had less than we could take, it is drained
+        if ((size_t)received < space) {
+            return;
+        }
     }
+}
+
+bool IPCManager::parseFrames(IPCClient& client) {
+    // size of the incomplete frame left in the inbox, if its header arrived
+    size_t partialFrameSize = 0;
 
-    std::string payload;
-    if (length > 0) {
-        std::vector<char> buffer(length);
-        ssize_t body_bytes = recv(fd, buffer.data(), length, 0);
-        if (body_bytes != (ssize_t)length) {
-            self->disconnectClient(client);
-            return 0;
+    while (client.inbox_end - client.inbox_begin >= IPC_HEADER_SIZE) {
+        const char* header = client.inbox.data() + client.inbox_begin;
+
+        if (memcmp(header, "i3-ipc", 6) != 0) {
+            LLog::warning("[IPCManager]: invalid frame from client fd %d, disconnecting it", client.fd);
+            disconnectClient(client);
+            return false;
+        }
+
+        uint32_t length, type;
+        memcpy(&length, header + 6, 4);
+        memcpy(&type, header + 10, 4);
+
+        if (length > IPC_MAX_PAYLOAD) {
+            LLog::warning("[IPCManager]: frame of %u bytes from client fd %d is too large, disconnecting it", length, client.fd);
+            disconnectClient(client);
+            return false;
+        }
+
+        // body not fully received yet
+        if (client.inbox_end - client.inbox_begin < IPC_HEADER_SIZE + length) {
+            partialFrameSize = IPC_HEADER_SIZE + length;
+            break;
+        }
+
+        IPCMessage message {type, std::string_view(header + IPC_HEADER_SIZE, length)};
+        client.inbox_begin += IPC_HEADER_SIZE + length;
+        handleMessage(client, message);
+
+        if (client.fd < 0) {
+            return false;
         }
-        payload = std::string(buffer.data(), length);
     }
-    
-    IPCMessage message {type, payload};
-    self->handleMessage(client, message);
-    return 0;
+
+    // keep the incomplete frame at the front and make room for the rest of it, the inbox is never shrunk
+    const size_t pending = client.inbox_end - client.inbox_begin;
+    if (pending > 0 && client.inbox_begin > 0) {
+        memmove(client.inbox.data(), client.inbox.data() + client.inbox_begin, pending);
+    }
+    client.inbox_begin = 0;
+    client.inbox_end = pending;
+    if (partialFrameSize > client.inbox.size()) {
+        client.inbox.resize(partialFrameSize);
+    }
+    return true;
 }
 
 void IPCManager::handleMessage(IPCClient& client, const IPCMessage& message) {
     switch (message.type) {
+        case IPC_COMMAND:
+            handleRunCommand(client, message.payload);
+            break;
         case IPC_GET_WORKSPACES:
             handleGetWorkspaces(client);
             break;
@@ -269,6 +580,9 @@ void IPCManager::handleMessage(IPCClient& client, const IPCMessage& message) {
         case IPC_GET_TREE:
             handleGetTree(client);
             break;
+        case IPC_TILEY_PERFMON:
+            handlePerfmon(client, message.payload);
+            break;
         default: {
             json error_json { {"success", false}, {"error", "Unknown message type"} };
             std::string packet = createIPCPacket(message.type, error_json.dump());
@@ -278,32 +592,194 @@ void IPCManager::handleMessage(IPCClient& client, const IPCMessage& message) {
     }
 }
 
+std::shared_ptr<const std::string> IPCManager::cachedReply(SerializedReply& cache, uint32_t type, json (*build)()) {
+    // polled several times a second by bars, while nothing changes the same buffer is queued again
+    const UInt64 generation = TileyWindowStateManager::getInstance().stateGeneration();
+    if (!cache.packet || cache.generation != generation) {
+        cache.packet = std::make_shared<const std::string>(createIPCPacket(type, build().dump()));
+        cache.generation = generation;
+    }
+    return cache.packet;
+}
+
 void IPCManager::handleGetOutputs(IPCClient& client) {
-    json outputs = json::array();
-    outputs.push_back({
-        {"name", "eDP-1"}, {"make", "Unknown"}, {"model", "Unknown"},
-        {"serial", "Unknown"}, {"active", true}, {"primary", true},
-        {"scale", 1.0}, {"subpixel_hinting", "rgb"}, {"transform", "normal"},
-        {"rect", {{"x", 0}, {"y", 0}, {"width", 1920}, {"height", 1080}}}
-    });
-    std::string packet = createIPCPacket(IPC_GET_OUTPUTS, outputs.dump());
-    sendMessage(client, packet);
+    queuePacket(client, cachedReply(m_outputs_reply, IPC_GET_OUTPUTS, &createOutputList));
 }
 
 void IPCManager::handleGetTree(IPCClient& client) {
-    json tree {
-        {"id", 1}, {"name", "root"}, {"type", "root"}, {"nodes", json::array()}
-    };
-    std::string packet = createIPCPacket(IPC_GET_TREE, tree.dump());
+    queuePacket(client, cachedReply(m_tree_reply, IPC_GET_TREE, &createTree));
+}
+
+// focused window: the keyboard focus, or the activated tiled window if a layer surface has it
+static ToplevelRole* focusedWindow() {
+    LSurface* focus = seat()->keyboard()->focus();
+    if (focus && focus->toplevel()) {
+        return static_cast<ToplevelRole*>(focus->toplevel());
+    }
+    Container* container = TileyWindowStateManager::getInstance().activatedContainer();
+    return container ? static_cast<ToplevelRole*>(container->getWindow()) : nullptr;
+}
+
+static json commandResult(bool success, const std::string& error = "") {
+    if (success) {
+        return {{"success", true}};
+    }
+    return {{"success", false}, {"parse_error", false}, {"error", error}};
+}
+
+// runCommand: a single command of a RUN_COMMAND batch, layout changes are only scheduled
+static json runCommand(const std::string& command) {
+    auto& manager = TileyWindowStateManager::getInstance();
+    std::istringstream stream(command);
+    std::vector<std::string> args;
+    for (std::string arg; stream >> arg;) {
+        args.push_back(arg);
+    }
+
+    if (args.empty()) {
+        return commandResult(false, "Empty command");
+    }
+    const std::string& name = args[0];
+
+    if (name == "exec") {
+        const size_t start = command.find_first_not_of(" \t", command.find("exec") + 4);
+        if (start == std::string::npos) {
+            return commandResult(false, "Expected a command to execute");
+        }
+        return commandResult(LLauncher::launch(command.substr(start)) > 0, "Unable to launch the command");
+    }
+
+    if (name == "workspace") {
+        // "workspace 3" or "workspace number 3"
+        const std::string& number = args.size() > 2 && args[1] == "number" ? args[2] : (args.size() > 1 ? args[1] : "");
+        char* end = nullptr;
+        const long num = strtol(number.c_str(), &end, 10);
+        if (number.empty() || *end != '\0' || num < 1 || num > manager.WORKSPACES) {
+            return commandResult(false, "Expected a workspace number between 1 and " + std::to_string(manager.WORKSPACES));
+        }
+        const UInt32 target = num - 1;
+        // the current workspace is only updated at the end of the animation, asking for its target again is fine
+        if (manager.switchingWorkspace()) {
+            return commandResult(target == manager.targetWorkspace(), "Another workspace switch is in progress");
+        }
+        // switching to the current workspace is not an error
+        if (target == manager.currentWorkspace()) {
+            return commandResult(true);
+        }
+        return commandResult(manager.switchWorkspace(target), "Unable to switch to workspace " + number);
+    }
+
+    // these act on the focused window and its workspace, which are stale until a running switch ends
+    if ((name == "floating" || name == "focus" || name == "resize") && manager.switchingWorkspace()) {
+        return commandResult(false, "A workspace switch is in progress");
+    }
+
+    if (name == "floating") {
+        ToplevelRole* window = focusedWindow();
+        if (!window || args.size() < 2) {
+            return commandResult(false, window ? "Expected floating enable|disable|toggle" : "No window is focused");
+        }
+        const bool stacked = manager.isStackedWindow(window);
+        if ((args[1] == "enable" && stacked) || (args[1] == "disable" && !stacked)) {
+            return commandResult(true);
+        }
+        if (args[1] != "enable" && args[1] != "disable" && args[1] != "toggle") {
+            return commandResult(false, "Expected floating enable|disable|toggle");
+        }
+        return commandResult(manager.toggleStackWindow(window), "The window cannot be toggled");
+    }
+
+    if (name == "focus") {
+        static const std::pair<const char*, LEdge> directions[] = {
+            {"left", LEdgeLeft}, {"right", LEdgeRight}, {"up", LEdgeTop}, {"down", LEdgeBottom}
+        };
+        for (const auto& [direction, edge] : directions) {
+            if (args.size() == 2 && args[1] == direction) {
+                return commandResult(manager.focusTile(edge), "No tiled window in this direction");
+            }
+        }
+        return commandResult(false, "Expected focus left|right|up|down");
+    }
+
+    if (name == "resize") {
+        // resize grow|shrink width|height <amount> [px|ppt]
+        if (args.size() < 4 || (args[1] != "grow" && args[1] != "shrink") || (args[2] != "width" && args[2] != "height")) {
+            return commandResult(false, "Expected resize grow|shrink width|height <amount> [px|ppt]");
+        }
+        char* end = nullptr;
+        const long amount = strtol(args[3].c_str(), &end, 10);
+        const std::string unit = args.size() > 4 ? args[4] : "px";
+        if (*end != '\0' || amount <= 0 || (unit != "px" && unit != "ppt")) {
+            return commandResult(false, "Expected a positive amount in px or ppt");
+        }
+
+        Container* container = manager.activatedContainer();
+        if (!container) {
+            return commandResult(false, "No tiled window is focused");
+        }
+        const bool horizontal = args[2] == "width";
+        Int32 delta = amount;
+        // percentage points of the workspace area
+        if (unit == "ppt") {
+            Output* output = manager.workspaceOutput(manager.getWorkspace(container));
+            const Int32 total = output ? (horizontal ? output->availableGeometry().w() : output->availableGeometry().h()) : 0;
+            delta = total * amount / 100;
+        }
+        if (args[1] == "shrink") {
+            delta = -delta;
+        }
+        return commandResult(manager.resizeTile(container, horizontal, delta), "The window cannot be resized in this direction");
+    }
+
+    if (name == "kill") {
+        // only the focused window is asked to close, not every window of its client
+        ToplevelRole* window = focusedWindow();
+        if (!window) {
+            return commandResult(false, "No window is focused");
+        }
+        window->close();
+        return commandResult(true);
+    }
+
+    // actions of the shortcut configuration, e.g. "goto_ws_2", "toggle_floating"
+    if (args.size() == 1 && ShortcutManager::getInstance().hasAction(name)) {
+        return commandResult(ShortcutManager::getInstance().runAction(name), "The action " + name + " had no effect");
+    }
+
+    return {{"success", false}, {"parse_error", true}, {"error", "Unknown command: " + name}};
+}
+
+void IPCManager::handleRunCommand(IPCClient& client, std::string_view payload) {
+    auto& manager = TileyWindowStateManager::getInstance();
+    json results = json::array();
+
+    // windows touched by the batch only get configured once, by the layout pass after the last command
+    size_t begin = 0;
+    while (begin <= payload.size()) {
+        size_t end = payload.find(';', begin);
+        if (end == std::string_view::npos) {
+            end = payload.size();
+        }
+        std::string command(payload.substr(begin, end - begin));
+        if (command.find_first_not_of(" \t\n") != std::string::npos) {
+            results.push_back(runCommand(command));
+        }
+        begin = end + 1;
+    }
+
+    // queries sent after this reply already see the new layout
+    manager.flushScheduledReflows();
+
+    std::string packet = createIPCPacket(IPC_COMMAND, results.dump());
     sendMessage(client, packet);
 }
 
 void IPCManager::handleGetWorkspaces(IPCClient& client) {
     try {
-        auto& manager = TileyWindowStateManager::getInstance();
-        json workspaces = createWorkspaceList(manager.currentWorkspace(), manager.WORKSPACES);
-        std::string packet = createIPCPacket(IPC_GET_WORKSPACES, workspaces.dump());
-        sendMessage(client, packet);
+        queuePacket(client, cachedReply(m_workspaces_reply, IPC_GET_WORKSPACES, []() {
+            auto& manager = TileyWindowStateManager::getInstance();
+            return createWorkspaceList(manager.currentWorkspace(), manager.WORKSPACES);
+        }));
     } catch (const std::exception& e) {
         LLog::error("[IPCManager] Exception in handleGetWorkspaces: %s", e.what());
         std::string emergency_response = R"([{"id":1,"name":"1","focused":true}])";
@@ -312,25 +788,49 @@ void IPCManager::handleGetWorkspaces(IPCClient& client) {
     }
 }
 
-void IPCManager::handleSubscribe(IPCClient& client, const std::string& payload) {
-    bool subscribed_to_workspace_event = false;
+static uint32_t subscriptionOf(const std::string& event) {
+    if (event == "workspace") return IPC_SUBSCRIPTION_WORKSPACE;
+    if (event == "output") return IPC_SUBSCRIPTION_OUTPUT;
+    // tiley has a single binding mode, subscribing is accepted but no mode event is emitted
+    if (event == "mode") return IPC_SUBSCRIPTION_MODE;
+    if (event == "window") return IPC_SUBSCRIPTION_WINDOW;
+    if (event == "binding") return IPC_SUBSCRIPTION_BINDING;
+    if (event == "shutdown") return IPC_SUBSCRIPTION_SHUTDOWN;
+    if (event == "perfmon") return IPC_SUBSCRIPTION_PERFMON;
+    return IPC_SUBSCRIPTION_NONE;
+}
+
+void IPCManager::handleSubscribe(IPCClient& client, std::string_view payload) {
     try {
-        auto events = json::parse(payload);
+        // like sway, one unknown event fails the whole request
+        uint32_t subscriptions = IPC_SUBSCRIPTION_NONE;
+        bool success = false;
+        auto events = json::parse(payload.begin(), payload.end());
         if (events.is_array()) {
+            success = true;
             for (const auto& event : events) {
-                if (event.is_string() && event.get<std::string>() == "workspace") {
-                    client.subscribed_to_workspace = true;
-                    subscribed_to_workspace_event = true;
+                uint32_t subscription = event.is_string() ? subscriptionOf(event.get<std::string>()) : IPC_SUBSCRIPTION_NONE;
+                if (subscription == IPC_SUBSCRIPTION_NONE) {
+                    success = false;
+                    break;
                 }
+                subscriptions |= subscription;
             }
         }
-        
-        std::string response = "{\"success\": true}";
+
+        const uint32_t added = success ? subscriptions & ~client.subscriptions : IPC_SUBSCRIPTION_NONE;
+        if (success) {
+            client.subscriptions |= subscriptions;
+        }
+
+        std::string response = success ? "{\"success\": true}" : "{\"success\": false}";
         std::string packet = createIPCPacket(IPC_REPLY_SUBSCRIBE, response);
-        sendMessage(client, packet);
+        if (!sendMessage(client, packet)) {
+            return;
+        }
         
         // Send workspace switching event
-        if (subscribed_to_workspace_event) {
+        if (added & IPC_SUBSCRIPTION_WORKSPACE) {
             auto& manager = TileyWindowStateManager::getInstance();
             broadcastWorkspaceUpdate(manager.currentWorkspace(), manager.WORKSPACES, &client);
         }
@@ -339,61 +839,285 @@ void IPCManager::handleSubscribe(IPCClient& client, const std::string& payload)
     }
 }
 
-void IPCManager::sendMessage(IPCClient& client, const std::string& message) {
-    if (client.fd < 0) return;
+// payload: sinks to switch to("csv,trace,ipc,zones", "off", see parsePerfmonSinks), empty to only query the state
+void IPCManager::handlePerfmon(IPCClient& client, std::string_view payload) {
+    json reply;
+    unsigned sinks;
+    if (payload.empty()) {
+        reply = {{"success", true}};
+    } else if (parsePerfmonSinks(std::string(payload), sinks)) {
+        setPerfmonSinks(sinks);
+        LLog::log("[IPCManager]: perfmon sinks set to %s", perfmonSinksToString(sinks).c_str());
+        reply = {{"success", true}};
+    } else {
+        reply = {{"success", false}, {"error", "Unknown perfmon sink, expected a list of csv, trace, ipc, zones or off"}};
+    }
+
+    sinks = perfmonSinks();
+    reply["enabled"] = sinks != PERFMON_SINK_NONE;
+    reply["sinks"] = perfmonSinksToString(sinks);
+
+    std::string packet = createIPCPacket(IPC_TILEY_PERFMON, reply.dump());
+    sendMessage(client, packet);
+}
+
+int IPCManager::handlePerfmonStream(int fd, uint32_t mask, void* data) {
+    L_UNUSED(mask);
+    IPCManager* self = static_cast<IPCManager*>(data);
+
+    eventfd_t count;
+    eventfd_read(fd, &count);
+
+    // reports are dropped when nobody listens, the stream must not grow
+    std::vector<PerfStreamEntry> entries = IpcStreamSink::take();
+    if (!self->hasSubscribers(IPC_SUBSCRIPTION_PERFMON)) {
+        return 0;
+    }
+
+    for (PerfStreamEntry& entry : entries) {
+        const FrameStats& s = entry.report.stats;
+        json event {
+            {"output", entry.tag},
+            {"fps", s.fps},
+            {"frame_time_ms", {{"p50", s.p50_ms}, {"p95", s.p95_ms}, {"p99", s.p99_ms}, {"max", s.max_ms}}},
+            {"avg_render_ms", s.avg_render_ms},
+            {"input_latency_ms", {{"count", s.latency_count}, {"p50", s.latency_p50_ms}, {"p95", s.latency_p95_ms},
+                                  {"p99", s.latency_p99_ms}, {"max", s.latency_max_ms}}},
+            {"cpu_seconds", entry.report.cpu_seconds},
+            {"memory_mb", entry.report.memory_mb},
+            {"dropped", entry.report.dropped}
+        };
+        self->broadcastEvent(IPC_SUBSCRIPTION_PERFMON, IPC_EVENT_PERFMON, event);
+    }
+    return 0;
+}
+
+bool IPCManager::sendMessage(IPCClient& client, const std::string& message) {
+    return queuePacket(client, std::make_shared<const std::string>(message));
+}
+
+bool IPCManager::queuePacket(IPCClient& client, std::shared_ptr<const std::string> packet, uint32_t coalesceType) {
+    if (client.fd < 0) {
+        return false;
+    }
+
+    if (coalesceType != 0) {
+        // only the newest state matters, drop the one still waiting(a partially sent packet has to be finished)
+        auto it = client.outbox.begin() + (client.outbox_offset > 0 ? 1 : 0);
+        for (; it != client.outbox.end(); ++it) {
+            if (it->coalesce_type == coalesceType) {
+                client.outbox_bytes -= it->data->size();
+                client.outbox.erase(it);
+                break;
+            }
+        }
+    }
+
+    client.outbox_bytes += packet->size();
+    client.outbox.push_back({std::move(packet), coalesceType});
+
+    if (!flushOutbox(client)) {
+        return false;
+    }
+
+    if (client.outbox_bytes > IPC_OUTBOX_HIGH_WATER) {
+        LLog::warning("[IPCManager]: client fd %d stopped reading(%zu bytes pending), disconnecting it", client.fd, client.outbox_bytes);
+        disconnectClient(client);
+        return false;
+    }
+    return true;
+}
+
+bool IPCManager::flushOutbox(IPCClient& client) {
+    while (!client.outbox.empty()) {
+        // several queued packets in one call
+        iovec iov[IPC_MAX_IOVECS];
+        int count = 0;
+        for (auto it = client.outbox.begin(); it != client.outbox.end() && count < IPC_MAX_IOVECS; ++it, ++count) {
+            const size_t offset = count == 0 ? client.outbox_offset : 0;
+            iov[count].iov_base = const_cast<char*>(it->data->data() + offset);
+            iov[count].iov_len = it->data->size() - offset;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t sent = sendmsg(client.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
 
-    size_t sent_total = 0;
-    while (sent_total < message.size()) {
-        ssize_t sent = send(client.fd, message.data() + sent_total, 
-                           message.size() - sent_total, MSG_NOSIGNAL);
-        
         if (sent < 0) {
-            if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                disconnectClient(client);
-                return;
+            if (errno == EINTR) {
+                continue;
             }
-            usleep(1000);
-            continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            disconnectClient(client);
+            return false;
+        }
+
+        client.outbox_bytes -= sent;
+        size_t remaining = sent;
+        while (remaining > 0) {
+            const size_t left = client.outbox.front().data->size() - client.outbox_offset;
+            if (remaining < left) {
+                client.outbox_offset += remaining;
+                break;
+            }
+            remaining -= left;
+            client.outbox.pop_front();
+            client.outbox_offset = 0;
         }
-        sent_total += sent;
     }
+
+    // wake up for writability only while something is waiting
+    watchWritable(client, !client.outbox.empty());
+    return true;
 }
 
-void IPCManager::broadcastWorkspaceUpdate(UInt32 currentWorkspace, UInt32 totalWorkspaces, IPCClient* targetClient) {
-    if (!targetClient && m_clients.empty()) {
+void IPCManager::watchWritable(IPCClient& client, bool watch) {
+    if (client.watching_writable == watch || !client.event_source) {
         return;
     }
+    wl_event_source_fd_update(client.event_source, WL_EVENT_READABLE | (watch ? WL_EVENT_WRITABLE : 0));
+    client.watching_writable = watch;
+}
+
+bool IPCManager::hasSubscribers(uint32_t subscription) const {
+    for (const IPCClient* client : m_clients) {
+        if (client->fd >= 0 && (client->subscriptions & subscription)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void IPCManager::broadcastEvent(uint32_t subscription, uint32_t type, const json& payload, uint32_t coalesceType) {
+    auto packet = std::make_shared<const std::string>(createIPCPacket(type, payload.dump()));
 
-    json event_payload = createWorkspaceEvent(currentWorkspace, totalWorkspaces);
-    std::string packet = createIPCPacket(IPC_EVENT_WORKSPACE, event_payload.dump());
+    // backwards: a client erased by queuePacket is replaced by the last one, which was already visited
+    for (size_t i = m_clients.size(); i-- > 0;) {
+        IPCClient& client = *m_clients[i];
+        if (client.subscriptions & subscription) {
+            queuePacket(client, packet, coalesceType);
+        }
+    }
+}
 
+void IPCManager::broadcastWorkspaceUpdate(UInt32 currentWorkspace, UInt32 totalWorkspaces, IPCClient* targetClient) {
     if (targetClient) {
-        if (targetClient->subscribed_to_workspace) {
-            sendMessage(*targetClient, packet);
+        if (targetClient->subscriptions & IPC_SUBSCRIPTION_WORKSPACE) {
+            json event_payload = createWorkspaceEvent(currentWorkspace, totalWorkspaces);
+            queuePacket(*targetClient, std::make_shared<const std::string>(createIPCPacket(IPC_EVENT_WORKSPACE, event_payload.dump())),
+                        IPC_EVENT_WORKSPACE);
         }
-    } else {
-        for (auto& client : m_clients) {
-            if (client.subscribed_to_workspace) {
-                sendMessage(client, packet);
-            }
+        return;
+    }
+
+    if (!hasSubscribers(IPC_SUBSCRIPTION_WORKSPACE)) {
+        return;
+    }
+    broadcastEvent(IPC_SUBSCRIPTION_WORKSPACE, IPC_EVENT_WORKSPACE, createWorkspaceEvent(currentWorkspace, totalWorkspaces), IPC_EVENT_WORKSPACE);
+}
+
+void IPCManager::broadcastWindowEvent(ToplevelRole* window, const char* change) {
+    if (!window || !hasSubscribers(IPC_SUBSCRIPTION_WINDOW)) {
+        return;
+    }
+
+    const LRect rect = window->container ? window->container->getGeometry() : LRect(window->surface()->pos(), window->surface()->size());
+    const bool focused = window->surface() == seat()->keyboard()->focus();
+    broadcastEvent(IPC_SUBSCRIPTION_WINDOW, IPC_EVENT_WINDOW, {
+        {"change", change},
+        {"container", createWindowNode(window, rect, focused)}
+    });
+}
+
+void IPCManager::broadcastOutputEvent() {
+    if (!hasSubscribers(IPC_SUBSCRIPTION_OUTPUT)) {
+        return;
+    }
+    // sway does not tell which output changed either, clients query GET_OUTPUTS
+    broadcastEvent(IPC_SUBSCRIPTION_OUTPUT, IPC_EVENT_OUTPUT, {{"change", "unspecified"}}, IPC_EVENT_OUTPUT);
+}
+
+void IPCManager::broadcastBindingEvent(const std::string& command, const std::string& combo) {
+    if (!hasSubscribers(IPC_SUBSCRIPTION_BINDING)) {
+        return;
+    }
+
+    // "ctrl+shift+t": modifiers first, the key last
+    json modifiers = json::array();
+    std::string symbol;
+    size_t begin = 0;
+    while (begin <= combo.size()) {
+        size_t end = combo.find('+', begin);
+        if (end == std::string::npos) {
+            symbol = combo.substr(begin);
+            break;
         }
+        modifiers.push_back(combo.substr(begin, end - begin));
+        begin = end + 1;
     }
+
+    broadcastEvent(IPC_SUBSCRIPTION_BINDING, IPC_EVENT_BINDING, {
+        {"change", "run"},
+        {"binding", {
+            {"command", command},
+            {"event_state_mask", std::move(modifiers)},
+            {"input_code", 0},
+            {"symbol", symbol},
+            {"input_type", "keyboard"}
+        }}
+    });
+}
+
+void IPCManager::broadcastShutdown() {
+    if (!hasSubscribers(IPC_SUBSCRIPTION_SHUTDOWN)) {
+        return;
+    }
+    broadcastEvent(IPC_SUBSCRIPTION_SHUTDOWN, IPC_EVENT_SHUTDOWN, {{"change", "exit"}});
 }
 
 void IPCManager::disconnectClient(IPCClient& client) {
-    if (client.read_event_source) {
-        wl_event_source_remove(client.read_event_source);
-        client.read_event_source = nullptr;
+    if (client.event_source) {
+        wl_event_source_remove(client.event_source);
+        client.event_source = nullptr;
     }
     
     if (client.fd >= 0) {
         close(client.fd);
         client.fd = -1;
     }
-    
-    auto it = std::find_if(m_clients.begin(), m_clients.end(),
-                          [&client](const IPCClient& c) { return &c == &client; });
-    if (it != m_clients.end()) {
-        m_clients.erase(it);
+
+    // still referenced by handleClientMessage, it erases the client when done
+    if (&client == m_dispatching) {
+        return;
+    }
+
+    eraseClient(client);
+}
+
+IPCManager::IPCClient& IPCManager::registerClient(int fd) {
+    // fds are small and reused by the kernel, the slots stay dense
+    if ((size_t)fd >= m_client_slots.size()) {
+        m_client_slots.resize(std::max<size_t>(fd + 1, m_client_slots.size() * 2));
     }
+
+    auto& slot = m_client_slots[fd];
+    slot = std::make_unique<IPCClient>();
+    slot->fd = fd;
+    slot->slot = fd;
+    slot->index = m_clients.size();
+    m_clients.push_back(slot.get());
+    return *slot;
+}
+
+void IPCManager::eraseClient(IPCClient& client) {
+    // swap with the last client of the list
+    IPCClient* last = m_clients.back();
+    m_clients[client.index] = last;
+    last->index = client.index;
+    m_clients.pop_back();
+
+    m_client_slots[client.slot].reset();
 }
@@ -1,28 +1,77 @@
 #pragma once
 
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
-#include <list>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <wayland-server-core.h>
 
 #include <LNamespaces.h>
+#include <nlohmann/json_fwd.hpp>
 
 using namespace Louvre;
 
 namespace tiley {
+    class ToplevelRole;
+}
+
+namespace tiley {
+
+    // events a client subscribed to, one bit per event name of the subscribe request
+    enum IPCSubscription : uint32_t {
+        IPC_SUBSCRIPTION_NONE = 0,
+        IPC_SUBSCRIPTION_WORKSPACE = 1 << 0,
+        IPC_SUBSCRIPTION_OUTPUT = 1 << 1,
+        IPC_SUBSCRIPTION_MODE = 1 << 2,
+        IPC_SUBSCRIPTION_WINDOW = 1 << 3,
+        IPC_SUBSCRIPTION_BINDING = 1 << 5,
+        IPC_SUBSCRIPTION_SHUTDOWN = 1 << 6,
+        // tiley extension
+        IPC_SUBSCRIPTION_PERFMON = 1 << 16
+    };
 
     class IPCManager {
         public:
+            // A packet waiting for the client socket. The buffer is immutable, broadcasts share it between clients
+            struct OutboundPacket {
+                std::shared_ptr<const std::string> data;
+                // a newer packet with the same non-zero type replaces this one while it is still queued
+                uint32_t coalesce_type = 0;
+            };
+
             struct IPCClient {
                 int fd = -1;
-                bool subscribed_to_workspace = false;
-                struct wl_event_source* read_event_source = nullptr;
+                // registry position: slot is the fd the client was accepted with(kept after closing), index is in the client list
+                int slot = -1;
+                size_t index = 0;
+                // IPCSubscription bits
+                uint32_t subscriptions = IPC_SUBSCRIPTION_NONE;
+                // readable: requests, writable: only watched while the outbox is not empty
+                struct wl_event_source* event_source = nullptr;
+                bool watching_writable = false;
+                // written as fast as the client reads, the compositor never waits for it
+                std::deque<OutboundPacket> outbox;
+                size_t outbox_offset = 0;  // bytes of outbox.front() already sent
+                size_t outbox_bytes = 0;   // unsent bytes of the whole outbox
+                // received bytes not parsed yet are [inbox_begin, inbox_end), starts small and grows to the largest frame, reused
+                std::vector<char> inbox;
+                size_t inbox_begin = 0;
+                size_t inbox_end = 0;
             };
 
             struct IPCMessage {
                 uint32_t type;
-                std::string payload;
+                // points into the client inbox, valid while the message is handled
+                std::string_view payload;
+            };
+
+            // A query reply serialized for a state generation of the window manager, see `TileyWindowStateManager::stateGeneration`
+            struct SerializedReply {
+                UInt64 generation = 0;
+                std::shared_ptr<const std::string> packet;
             };
 
             struct IPCManagerDeleter {
@@ -34,6 +83,14 @@ namespace tiley {
             static IPCManager& getInstance();
             void initialize();
             void broadcastWorkspaceUpdate(UInt32 currentWorkspace, UInt32 totalWorkspaces, IPCClient* targetClient = nullptr);
+            // broadcastWindowEvent: `change` is one of sway's window changes(new, close, focus...)
+            void broadcastWindowEvent(ToplevelRole* window, const char* change);
+            // broadcastOutputEvent: outputs were plugged, unplugged or reconfigured
+            void broadcastOutputEvent();
+            // broadcastBindingEvent: a shortcut ran `command`, `combo` is the normalized key combination
+            void broadcastBindingEvent(const std::string& command, const std::string& combo);
+            // broadcastShutdown: the compositor is exiting, sent while the event loop still runs
+            void broadcastShutdown();
         private:
             IPCManager();
             ~IPCManager();
@@ -43,18 +100,50 @@ namespace tiley {
 
             int m_socket_fd;
             struct wl_event_source* m_listen_event_source;
-            std::list<IPCClient> m_clients;
+            // perfmon reports waiting for "perfmon" subscribers
+            struct wl_event_source* m_perfmon_event_source = nullptr;
+            // registry: fd-indexed slots own the clients, the dense list is what broadcasts iterate
+            std::vector<std::unique_ptr<IPCClient>> m_client_slots;
+            std::vector<IPCClient*> m_clients;
+            // client whose socket is being handled, disconnecting it only closes it until the callback returns
+            IPCClient* m_dispatching = nullptr;
+            // replies of the query messages, rebuilt only once the state changed
+            SerializedReply m_tree_reply;
+            SerializedReply m_outputs_reply;
+            SerializedReply m_workspaces_reply;
 
             static int handleNewConnection(int fd, uint32_t mask, void* data);
+            // handleClientMessage: `data` is the IPCClient
             static int handleClientMessage(int fd, uint32_t mask, void* data);
+            static int handlePerfmonStream(int fd, uint32_t mask, void* data);
 
+            // readFrames: receive what the socket has and handle every complete frame
+            void readFrames(IPCClient& client);
+            // parseFrames: handle the complete frames of the inbox, false if the client got disconnected
+            bool parseFrames(IPCClient& client);
             void handleMessage(IPCClient& client, const IPCMessage& message);
             void handleGetWorkspaces(IPCClient& client);
             void handleGetTree(IPCClient& client);
+            // handleRunCommand: `;` separated commands, laid out once after the whole batch
+            void handleRunCommand(IPCClient& client, std::string_view payload);
             void handleGetOutputs(IPCClient& client);
-            void handleSubscribe(IPCClient& client, const std::string& payload);
-            void sendMessage(IPCClient& client, const std::string& message);
+            void handleSubscribe(IPCClient& client, std::string_view payload);
+            void handlePerfmon(IPCClient& client, std::string_view payload);
+            // sendMessage/queuePacket: queue and write what the socket accepts right now.
+            // Returns false if the client was disconnected(and destroyed) meanwhile
+            bool sendMessage(IPCClient& client, const std::string& message);
+            bool queuePacket(IPCClient& client, std::shared_ptr<const std::string> packet, uint32_t coalesceType = 0);
+            bool flushOutbox(IPCClient& client);
+            // hasSubscribers: check before building an event payload nobody listens to
+            bool hasSubscribers(uint32_t subscription) const;
+            // broadcastEvent: serialize once, every subscriber queues the same buffer
+            void broadcastEvent(uint32_t subscription, uint32_t type, const nlohmann::json& payload, uint32_t coalesceType = 0);
+            // cachedReply: packet of `cache`, serialized again with `build` if the state changed since
+            std::shared_ptr<const std::string> cachedReply(SerializedReply& cache, uint32_t type, nlohmann::json (*build)());
+            void watchWritable(IPCClient& client, bool watch);
             void disconnectClient(IPCClient& client);
+            IPCClient& registerClient(int fd);
+            void eraseClient(IPCClient& client);
             
             std::string createIPCPacket(uint32_t type, const std::string& payload);
         };
@@ -0,0 +1,303 @@
+#include "LayoutEngine.hpp"
+
+#include <algorithm>
+
+using namespace tiley;
+
+// never destroyed: workspace roots may be released by other statics during exit
+static SlabPool<LayoutNode>& splitPool(){
+    static SlabPool<LayoutNode>* pool = new SlabPool<LayoutNode>();
+    return *pool;
+}
+
+LayoutNode* LayoutEngine::createSplit(SPLIT_TYPE split, float splitRatio){
+    SlabHandle handle = splitPool().create();
+    LayoutNode* node = splitPool().get(handle);
+    node->m_splitHandle = handle;
+    node->m_splitType = split;
+    node->m_splitRatio = splitRatio;
+    return node;
+}
+
+void LayoutEngine::destroySplit(LayoutNode* node){
+    if(node){
+        splitPool().destroy(node->m_splitHandle);
+    }
+}
+
+LayoutNode* LayoutEngine::createRoot(){
+    // root of a workspace works as the "desktop" node: first child takes the whole area
+    return createSplit(SPLIT_H, 1.0f);
+}
+
+void LayoutEngine::destroyRoot(LayoutNode* root){
+    if(!root){
+        return;
+    }
+
+    // splitting nodes are created by the engine, leaves belong to callers
+    auto destroySplits = [](auto& self, LayoutNode* node) -> void {
+        if(!node || node->isLeaf()){
+            return;
+        }
+        self(self, node->m_child1);
+        self(self, node->m_child2);
+        destroySplit(node);
+    };
+
+    destroySplits(destroySplits, root);
+}
+
+bool LayoutEngine::insertToRoot(LayoutNode* root, LayoutNode* leaf){
+    if(!root || !leaf || root->m_child1 || root->m_child2){
+        return false;
+    }
+
+    root->m_child1 = leaf;
+    leaf->m_parent = root;
+
+    markDirty(root);
+    markDirty(leaf);
+    return true;
+}
+
+bool LayoutEngine::insert(LayoutNode* target, LayoutNode* leaf, SPLIT_TYPE split, float splitRatio, const LayoutPoint& hint){
+
+    if(!target || !leaf || target == leaf){
+        return false;
+    }
+
+    // target must be typed window and already be inside a tree
+    if(!target->isLeaf() || !target->m_parent){
+        return false;
+    }
+
+    LayoutNode* parent = target->m_parent;
+
+    LayoutNode* splitNode = createSplit(split, splitRatio);
+    // the splitting node takes over the area of target, so that a clean parent does not need to be split again
+    splitNode->m_geometry = target->m_geometry;
+
+    if(parent->m_child1 == target){
+        parent->m_child1 = splitNode;
+    }else if(parent->m_child2 == target){
+        parent->m_child2 = splitNode;
+    }else{
+        // parent does not know target, the tree is corrupted
+        destroySplit(splitNode);
+        return false;
+    }
+    splitNode->m_parent = parent;
+
+    const LayoutRect& geo = target->m_geometry;
+    bool before;
+
+    if(split == SPLIT_H){
+        float midX = geo.x + geo.w * splitRatio;
+        before = (hint.x < midX);
+    }else{
+        float midY = geo.y + geo.h * splitRatio;
+        before = (hint.y < midY);
+    }
+
+    if(before){
+        splitNode->m_child1 = leaf;
+        splitNode->m_child2 = target;
+    }else{
+        splitNode->m_child1 = target;
+        splitNode->m_child2 = leaf;
+    }
+
+    leaf->m_parent = splitNode;
+    target->m_parent = splitNode;
+
+    markDirty(splitNode);
+    markDirty(leaf);
+    return true;
+}
+
+LayoutNode* LayoutEngine::detach(LayoutNode* leaf, std::uint32_t& removedNodes){
+
+    removedNodes = 0;
+
+    if(!leaf || !leaf->m_parent){
+        return nullptr;
+    }
+
+    LayoutNode* parent = leaf->m_parent;
+    LayoutNode* grandParent = parent->m_parent;
+    LayoutNode* sibling = (parent->m_child1 == leaf) ? parent->m_child2 : parent->m_child1;
+
+    leaf->m_parent = nullptr;
+    removedNodes = 1;
+
+    // parent is the root: there is no splitting node to collapse
+    if(grandParent == nullptr){
+        parent->m_child1 = sibling;
+        parent->m_child2 = nullptr;
+        markDirty(parent);
+        if(sibling){
+            sibling->m_parent = parent;
+            return sibling;
+        }
+        return parent;
+    }
+
+    // grandparent reclaims the sibling
+    if(grandParent->m_child1 == parent){
+        grandParent->m_child1 = sibling;
+    }else{
+        grandParent->m_child2 = sibling;
+    }
+
+    if(sibling){
+        sibling->m_parent = grandParent;
+    }
+
+    destroySplit(parent);
+    removedNodes += 1;
+
+    // sibling takes the whole area of the collapsed splitting node
+    markDirty(grandParent);
+
+    return sibling ? sibling : grandParent;
+}
+
+std::uint32_t LayoutEngine::reflow(LayoutNode* node, const LayoutRect& area){
+
+    if(node == nullptr){
+        return 0;
+    }
+
+    const bool areaChanged = node->m_geometry != area;
+
+    // nothing changed inside this subtree, skip it entirely
+    if(!areaChanged && !node->m_dirty && !node->m_subtreeDirty){
+        return 0;
+    }
+
+    const bool relayout = areaChanged || node->m_dirty;
+
+    node->m_geometry = area;
+    node->m_dirty = false;
+    node->m_subtreeDirty = false;
+
+    if(node->isLeaf()){
+        if(relayout){
+            node->geometryChanged();
+        }
+        return 1;
+    }
+
+    LayoutRect area1 = node->m_child1 ? node->m_child1->m_geometry : LayoutRect{};
+    LayoutRect area2 = node->m_child2 ? node->m_child2->m_geometry : LayoutRect{};
+
+    // children keep their areas unless this node has to be split again
+    if(relayout){
+        if(node->m_splitType == SPLIT_H){
+            std::int32_t child1Width = (std::int32_t)(area.w * node->m_splitRatio);
+            std::int32_t child2Width = area.w - child1Width;
+            area1 = {area.x, area.y, child1Width, area.h};
+            area2 = {area.x + child1Width, area.y, child2Width, area.h};
+        }else if(node->m_splitType == SPLIT_V){
+            std::int32_t child1Height = (std::int32_t)(area.h * node->m_splitRatio);
+            std::int32_t child2Height = area.h - child1Height;
+            area1 = {area.x, area.y, area.w, child1Height};
+            area2 = {area.x, area.y + child1Height, area.w, child2Height};
+        }
+    }
+
+    return 1 + reflow(node->m_child1, area1) + reflow(node->m_child2, area2);
+}
+
+void LayoutEngine::markDirty(LayoutNode* node){
+    if(!node){
+        return;
+    }
+
+    node->m_dirty = true;
+
+    // propagate up until an ancestor already knows about dirty nodes below
+    for(LayoutNode* ancestor = node->m_parent; ancestor && !ancestor->m_subtreeDirty; ancestor = ancestor->m_parent){
+        ancestor->m_subtreeDirty = true;
+    }
+}
+
+void LayoutEngine::findResizeTargets(LayoutNode* leaf, const LayoutNode* root, bool horizontal, bool vertical,
+                                     LayoutNode*& horizontalTarget, LayoutNode*& verticalTarget){
+    horizontalTarget = nullptr;
+    verticalTarget = nullptr;
+
+    if(!leaf || !leaf->m_parent){
+        return;
+    }
+
+    LayoutNode* current = leaf;
+
+    while(current->m_parent && current->m_parent != root){
+        LayoutNode* parent = current->m_parent;
+        if(horizontal && !horizontalTarget && parent->m_splitType == SPLIT_H){
+            horizontalTarget = parent;
+        }
+        if(vertical && !verticalTarget && parent->m_splitType == SPLIT_V){
+            verticalTarget = parent;
+        }
+        if((!horizontal || horizontalTarget) && (!vertical || verticalTarget)){
+            break;
+        }
+        current = parent;
+    }
+}
+
+bool LayoutEngine::resize(LayoutNode* target, double initialRatio, double delta){
+
+    if(!target || target->isLeaf()){
+        return false;
+    }
+
+    double total = target->m_splitType == SPLIT_H ? target->m_geometry.w : target->m_geometry.h;
+    if(total < 1){
+        return false;
+    }
+
+    double newRatio = initialRatio + delta / total;
+    float clamped = (float)std::clamp(newRatio, MIN_SPLIT_RATIO, MAX_SPLIT_RATIO);
+
+    if(clamped == target->m_splitRatio){
+        return false;
+    }
+
+    target->m_splitRatio = clamped;
+    markDirty(target);
+    return true;
+}
+
+std::uint32_t LayoutEngine::countNodes(const LayoutNode* root){
+    if(!root){
+        return 0;
+    }
+    return 1 + countNodes(root->m_child1) + countNodes(root->m_child2);
+}
+
+LayoutNode* LayoutEngine::firstLeaf(LayoutNode* root){
+    if(!root){
+        return nullptr;
+    }
+    if(root->isLeaf()){
+        return root;
+    }
+    if(LayoutNode* leaf = firstLeaf(root->m_child1)){
+        return leaf;
+    }
+    return firstLeaf(root->m_child2);
+}
+
+LayoutNode* LayoutEngine::rootOf(LayoutNode* node){
+    if(!node){
+        return nullptr;
+    }
+    while(node->m_parent){
+        node = node->m_parent;
+    }
+    return node;
+}
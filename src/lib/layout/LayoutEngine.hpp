@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#include "src/lib/layout/LayoutNode.hpp"
+#include "src/lib/layout/LayoutTypes.hpp"
+
+namespace tiley{
+
+    // Pure tiling algorithms operating on `LayoutNode` trees.
+    // Nothing in here may touch Louvre (cursor, compositor, roles...), callers pass every environmental input explicitly.
+    class LayoutEngine{
+        public:
+            // createRoot: create the root node of a workspace. Its first child spans the whole workspace area.
+            static LayoutNode* createRoot();
+            // destroyRoot: delete a root created by `createRoot` together with its splitting nodes. Leaves are owned by callers and left untouched.
+            static void destroyRoot(LayoutNode* root);
+
+            // insertToRoot: place `leaf` as the only tile of an empty workspace. Adds 1 node to the tree.
+            static bool insertToRoot(LayoutNode* root, LayoutNode* leaf);
+            // insert: split `target` and put `leaf` beside it. `hint`(e.g. cursor position) decides which half `leaf` takes.
+            // Adds 2 nodes(`leaf` and a splitting node) to the tree.
+            static bool insert(LayoutNode* target, LayoutNode* leaf, SPLIT_TYPE split, float splitRatio, const LayoutPoint& hint);
+            // detach: unlink `leaf` from its tree and collapse the splitting node it leaves behind.
+            // Returns the node which took the place of `leaf`, or the root if the workspace becomes empty.
+            // `removedNodes` is set to the amount of nodes which are no longer part of the tree(including `leaf`).
+            static LayoutNode* detach(LayoutNode* leaf, std::uint32_t& removedNodes);
+
+            // reflow: assign `area` to `node` and split it recursively among the subtree. Returns the amount of visited nodes.
+            // Only subtrees which are dirty or whose area changed are visited, and `geometryChanged` is only called on leaves
+            // which are dirty or received a different geometry.
+            static std::uint32_t reflow(LayoutNode* node, const LayoutRect& area);
+            // markDirty: request `node` to be laid out again by the next reflow. Tree mutations of the engine mark nodes by themselves.
+            static void markDirty(LayoutNode* node);
+
+            // findResizeTargets: find the nearest ancestors of `leaf`(below `root`) splitting horizontally/vertically
+            static void findResizeTargets(LayoutNode* leaf, const LayoutNode* root, bool horizontal, bool vertical,
+                                          LayoutNode*& horizontalTarget, LayoutNode*& verticalTarget);
+            // resize: move the split line of `target` by `delta` pixels, starting from `initialRatio`
+            static bool resize(LayoutNode* target, double initialRatio, double delta);
+
+            // countNodes: count nodes of a subtree, including splitting nodes
+            static std::uint32_t countNodes(const LayoutNode* root);
+            // firstLeaf: the first leaf in depth-first order
+            static LayoutNode* firstLeaf(LayoutNode* root);
+            // rootOf: trace up to the root of the tree `node` belongs to
+            static LayoutNode* rootOf(LayoutNode* node);
+
+            // bounds of split ratios while resizing
+            static constexpr double MIN_SPLIT_RATIO = 0.05;
+            static constexpr double MAX_SPLIT_RATIO = 0.95;
+
+        private:
+            // createSplit/destroySplit: splitting nodes(roots included) are allocated from one pool,
+            // so the nodes a reflow walks through sit next to each other
+            static LayoutNode* createSplit(SPLIT_TYPE split, float splitRatio);
+            static void destroySplit(LayoutNode* node);
+    };
+}
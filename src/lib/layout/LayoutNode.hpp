@@ -0,0 +1,61 @@
+#pragma once
+
+#include "src/lib/layout/LayoutTypes.hpp"
+#include "src/lib/layout/SlabPool.hpp"
+
+namespace tiley{
+    class LayoutEngine;
+}
+
+namespace tiley{
+
+    // A node of the tiling tree: either a split owning two children, or a leaf standing for a window.
+    // Nodes only carry layout data, display related state lives in subclasses (see `Container`).
+    class LayoutNode{
+        public:
+            LayoutNode() = default;
+            virtual ~LayoutNode() = default;
+
+            LayoutNode(const LayoutNode&) = delete;
+            LayoutNode& operator=(const LayoutNode&) = delete;
+
+            inline bool isLeaf() const { return m_splitType == SPLIT_NONE; }
+            inline SPLIT_TYPE splitType() const { return m_splitType; }
+            inline float splitRatio() const { return m_splitRatio; }
+            inline LayoutNode* parent() const { return m_parent; }
+            inline LayoutNode* child1() const { return m_child1; }
+            inline LayoutNode* child2() const { return m_child2; }
+            inline const LayoutRect& geometry() const { return m_geometry; }
+            // dirty: split ratio or children of this node changed since the last reflow
+            inline bool dirty() const { return m_dirty; }
+            // subtreeDirty: some node below this one is dirty
+            inline bool subtreeDirty() const { return m_subtreeDirty; }
+
+        protected:
+            // geometryChanged: called by LayoutEngine after a leaf has been assigned a new geometry
+            virtual void geometryChanged(){}
+
+        private:
+            // Dynamic tiling: split Type
+            SPLIT_TYPE m_splitType = SPLIT_NONE;
+            // Dynamic tiling: used by splitting nodes, ignored by leaves
+            float m_splitRatio = 0.5f;
+
+            LayoutNode* m_parent = nullptr;
+            LayoutNode* m_child1 = nullptr;
+            LayoutNode* m_child2 = nullptr;
+
+            // Isolated geometry data for caching realtime window geometry to avoid chaotic updates
+            LayoutRect m_geometry;
+
+            // Incremental reflow: only dirty paths of the tree are visited
+            bool m_dirty = true;
+            bool m_subtreeDirty = false;
+
+            // splitting nodes: slot in the engine's node pool
+            SlabHandle m_splitHandle;
+
+            // Only the engine mutates the tree
+            friend LayoutEngine;
+    };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Plain data types shared by the layout engine and the compositor.
+// Keep this header free of Louvre so that the layout engine can be built and measured headlessly.
+
+namespace tiley{
+
+    // Container split types
+    enum SPLIT_TYPE{
+        SPLIT_NONE,  // window
+        SPLIT_H,
+        SPLIT_V
+    };
+
+    // Integer rectangle in global compositor coordinates
+    struct LayoutRect{
+        std::int32_t x = 0;
+        std::int32_t y = 0;
+        std::int32_t w = 0;
+        std::int32_t h = 0;
+
+        bool operator==(const LayoutRect& other) const {
+            return x == other.x && y == other.y && w == other.w && h == other.h;
+        }
+        bool operator!=(const LayoutRect& other) const { return !(*this == other); }
+    };
+
+    struct LayoutPoint{
+        float x = 0.f;
+        float y = 0.f;
+    };
+}
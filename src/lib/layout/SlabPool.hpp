@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace tiley{
+
+    // A reference to an object of a `SlabPool`. The generation tells apart objects which reused the same slot,
+    // so a handle kept after its object was destroyed resolves to nullptr instead of dangling.
+    struct SlabHandle{
+        static constexpr std::uint32_t INVALID_INDEX = UINT32_MAX;
+
+        std::uint32_t index = INVALID_INDEX;
+        std::uint32_t generation = 0;
+
+        inline bool valid() const { return index != INVALID_INDEX; }
+        inline bool operator==(const SlabHandle& other) const { return index == other.index && generation == other.generation; }
+        inline bool operator!=(const SlabHandle& other) const { return !(*this == other); }
+    };
+
+    // Slab allocator: objects live in fixed-size blocks, so their addresses never change and neighbours in the tree
+    // tend to be neighbours in memory. Freed slots are recycled, `clear` destroys everything at once.
+    template<typename T, std::uint32_t SLAB_SIZE = 64>
+    class SlabPool{
+        public:
+            SlabPool() = default;
+            ~SlabPool(){ clear(); }
+
+            SlabPool(const SlabPool&) = delete;
+            SlabPool& operator=(const SlabPool&) = delete;
+
+            // create: construct an object in a free slot
+            template<typename... Args>
+            SlabHandle create(Args&&... args){
+                if(m_freeHead == SlabHandle::INVALID_INDEX){
+                    grow();
+                }
+
+                std::uint32_t index = m_freeHead;
+                Slot& s = slot(index);
+                m_freeHead = s.nextFree;
+
+                new (s.storage) T(std::forward<Args>(args)...);
+                s.alive = true;
+                m_size++;
+
+                return {index, s.generation};
+            }
+
+            // destroy: destroy the object referenced by `handle`. Stale handles are ignored.
+            bool destroy(SlabHandle handle){
+                T* object = get(handle);
+                if(!object){
+                    return false;
+                }
+
+                Slot& s = slot(handle.index);
+                object->~T();
+                s.alive = false;
+                // every handle of the old object becomes stale
+                s.generation++;
+                s.nextFree = m_freeHead;
+                m_freeHead = handle.index;
+                m_size--;
+                return true;
+            }
+
+            // get: resolve `handle`, nullptr if the object is gone
+            T* get(SlabHandle handle) const{
+                if(!handle.valid() || handle.index >= m_capacity){
+                    return nullptr;
+                }
+                Slot& s = slot(handle.index);
+                if(!s.alive || s.generation != handle.generation){
+                    return nullptr;
+                }
+                return std::launder(reinterpret_cast<T*>(s.storage));
+            }
+
+            // handleOf: find the handle of an object living in this pool, an invalid handle otherwise.
+            // Scans every slab, objects created often should keep the handle returned by `create` instead.
+            SlabHandle handleOf(const T* object) const{
+                if(!object){
+                    return {};
+                }
+                // slabs are unrelated arrays, only std::less gives their addresses a total order
+                const std::less<const unsigned char*> before;
+                const auto* address = reinterpret_cast<const unsigned char*>(object);
+                for(std::uint32_t i = 0; i < m_slabs.size(); i++){
+                    const auto* begin = reinterpret_cast<const unsigned char*>(m_slabs[i].get());
+                    const auto* end = begin + sizeof(Slot) * SLAB_SIZE;
+                    if(!before(address, begin) && before(address, end)){
+                        std::uint32_t index = i * SLAB_SIZE + (std::uint32_t)((address - begin) / sizeof(Slot));
+                        const Slot& s = slot(index);
+                        return s.alive ? SlabHandle{index, s.generation} : SlabHandle{};
+                    }
+                }
+                return {};
+            }
+
+            // forEach: visit alive objects in memory order
+            template<typename F>
+            void forEach(F&& visitor){
+                for(std::uint32_t index = 0; index < m_capacity; index++){
+                    Slot& s = slot(index);
+                    if(s.alive){
+                        visitor(*std::launder(reinterpret_cast<T*>(s.storage)));
+                    }
+                }
+            }
+
+            // clear: destroy every object at once, outstanding handles become stale
+            void clear(){
+                for(std::uint32_t index = 0; index < m_capacity; index++){
+                    Slot& s = slot(index);
+                    if(s.alive){
+                        destroy({index, s.generation});
+                    }
+                }
+            }
+
+            inline std::uint32_t size() const { return m_size; }
+            inline std::uint32_t capacity() const { return m_capacity; }
+
+        private:
+            struct Slot{
+                alignas(T) unsigned char storage[sizeof(T)];
+                std::uint32_t generation = 0;
+                std::uint32_t nextFree = SlabHandle::INVALID_INDEX;
+                bool alive = false;
+            };
+
+            inline Slot& slot(std::uint32_t index) const { return m_slabs[index / SLAB_SIZE][index % SLAB_SIZE]; }
+
+            // grow: append a slab and chain its slots into the free list, lowest index first
+            void grow(){
+                m_slabs.push_back(std::make_unique<Slot[]>(SLAB_SIZE));
+                std::uint32_t first = m_capacity;
+                m_capacity += SLAB_SIZE;
+                for(std::uint32_t index = m_capacity; index-- > first;){
+                    slot(index).nextFree = m_freeHead;
+                    m_freeHead = index;
+                }
+            }
+
+            std::vector<std::unique_ptr<Slot[]>> m_slabs;
+            std::uint32_t m_freeHead = SlabHandle::INVALID_INDEX;
+            std::uint32_t m_capacity = 0;
+            std::uint32_t m_size = 0;
+    };
+}
@@ -0,0 +1,72 @@
+#include "DamageAccumulator.hpp"
+
+#include "src/lib/TileyServer.hpp"
+#include "src/lib/output/Output.hpp"
+
+#include <LCompositor.h>
+#include <LSceneView.h>
+
+#include <algorithm>
+
+using namespace tiley;
+
+void DamageAccumulator::add(const LRect& rect){
+
+    if(rect.w() <= 0 || rect.h() <= 0){
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for(LOutput* output : compositor()->outputs()){
+        const LRect& area = output->rect();
+
+        const Int32 x1 = std::max(rect.x(), area.x());
+        const Int32 y1 = std::max(rect.y(), area.y());
+        const Int32 x2 = std::min(rect.x() + rect.w(), area.x() + area.w());
+        const Int32 y2 = std::min(rect.y() + rect.h(), area.y() + area.h());
+
+        if(x1 >= x2 || y1 >= y2){
+            continue;
+        }
+
+        m_damage[output].addRect(LRect(x1, y1, x2 - x1, y2 - y1));
+        output->repaint();
+        if(m_inputUs){
+            static_cast<Output*>(output)->markInput(m_inputUs);
+        }
+    }
+}
+
+UInt32 DamageAccumulator::beginInput(UInt32 us){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const UInt32 previousUs = m_inputUs;
+    m_inputUs = us;
+    return previousUs;
+}
+
+void DamageAccumulator::endInput(UInt32 previousUs){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_inputUs = previousUs;
+}
+
+void DamageAccumulator::flush(LOutput* output){
+
+    LRegion damage;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_damage.find(output);
+        if(it == m_damage.end() || it->second.empty()){
+            return;
+        }
+        damage = std::move(it->second);
+        it->second.clear();
+    }
+
+    TileyServer::getInstance().scene().mainView()->addDamage(output, damage);
+}
+
+void DamageAccumulator::forget(const LOutput* output){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_damage.erase(output);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <LNamespaces.h>
+#include <LOutput.h>
+#include <LRect.h>
+#include <LRegion.h>
+
+#include <mutex>
+#include <unordered_map>
+
+using namespace Louvre;
+
+namespace tiley{
+
+    // Areas of the global space changed by tiley(layout commits, animations...), accumulated per output.
+    // Only outputs intersecting a damaged area are asked for a new frame, the others keep sleeping.
+    // Each output hands its damage over to the scene right before painting.
+    class DamageAccumulator{
+        public:
+            // add: damage `rect`(global logical coordinates) and schedule repaints of the outputs it intersects
+            void add(const LRect& rect);
+            // flush: move the damage of `output` into the scene, called by the output before painting
+            void flush(LOutput* output);
+            // forget: drop the damage of an output being removed
+            void forget(const LOutput* output);
+            // beginInput/endInput: damage added in between is the result of an input(`us`: its event timestamp),
+            // the outputs it reaches measure its input-to-photon latency(see Output::markInput). Use InputDamageScope.
+            // beginInput returns the stamp it replaces, handed back to endInput when inputs are handled inside each other
+            UInt32 beginInput(UInt32 us);
+            void endInput(UInt32 previousUs);
+
+        private:
+            std::unordered_map<const LOutput*, LRegion> m_damage;
+            // timestamp of the input being handled, 0 outside of an input handler
+            UInt32 m_inputUs = 0;
+            // outputs paint in their own threads
+            std::mutex m_mutex;
+    };
+
+    // InputDamageScope: stamps the damage added during its lifetime with an input, see DamageAccumulator::beginInput
+    class InputDamageScope{
+        public:
+            InputDamageScope(DamageAccumulator& damage, UInt32 us) : m_damage(damage), m_previousUs(damage.beginInput(us)) {}
+            ~InputDamageScope() { m_damage.endInput(m_previousUs); }
+            InputDamageScope(const InputDamageScope&) = delete;
+            InputDamageScope& operator=(const InputDamageScope&) = delete;
+
+        private:
+            DamageAccumulator& m_damage;
+            UInt32 m_previousUs;
+    };
+}
@@ -10,16 +10,24 @@
 #include <LRegion.h>
 #include <LOpenGL.h>
 #include <LCursor.h>
+#include <LDND.h>
+#include <LSceneView.h>
+#include <LSeat.h>
 #include <LContentType.h>
 #include <LLog.h>
 
 #include "Output.hpp"
 
 #include "src/lib/TileyServer.hpp"
+#include "src/lib/TileyWindowStateManager.hpp"
 #include "src/lib/client/ToplevelRole.hpp"
 #include "src/lib/client/WallpaperManager.hpp"
+#include "src/lib/input/Pointer.hpp"
 #include "src/lib/surface/Surface.hpp"
 #include "src/lib/types.hpp"
+#include "src/test/TraceZone.hpp"
+
+#include <algorithm>
 
 using namespace Louvre;
 using namespace tiley;
@@ -42,6 +50,9 @@ void Output::initializeGL(){
         enableVSync(false);
     }
 
+    // resolved once, windows reach them for every frame
+    m_renderResources = &server.renderResources(this);
+
     // scene rendering
     server.scene().handleInitializeGL(this);
 
@@ -51,6 +62,10 @@ void Output::initializeGL(){
         this->setMode(mode);
     }
 
+    // batched windows are drawn when the scene reaches this view, right below popups
+    m_decorationFlushView.insertAfter(&server.layers()[APPLICATION_LAYER]);
+    updateDecorationFlushView();
+
     LWeak<Output> weakRef {this};
     fadeInView.insertAfter(&server.layers()[OVERLAY_LAYER]);
     fadeInView.setOpacity(0.f);
@@ -75,21 +90,40 @@ void Output::initializeGL(){
 
     updateWallpaper();
 
-    // Test settings
-    perfTag_ = "test";
-    // TODO: reformat hardcoded path
-    tiley::setPerfmonPath(perfTag_, "/home/zero/tiley/src/lib/test/test_1.txt");
-    // initialize testing manager
-    perfMon_ = &tiley::perfmon(perfTag_);
-    // End of Test settings
+    // one monitor per output: its sample queue must only be fed by this output's render thread
+    // the monitor itself is created once perfmon gets enabled(--perfmon, TILEY_PERFMON or IPC)
+    perfTag_ = name() ? std::string(name()) : "output-" + std::to_string(this->id());
 
+    TileyWindowStateManager::getInstance().markStateChanged();
 }
 
 void Output::paintGL(){
-  
-    // Test settings
-    tiley::setPerfmonPath("test", "/home/zero/tiley/src/lib/test/test_1.txt");
-    // End of Test settings
+    TILEY_TRACE_ZONE("Output::paintGL");
+
+    // perf monitoring costs one relaxed load per frame while it is off
+    PerformanceMonitor* perfMon = nullptr;
+    if (tiley::perfmonEnabled()) {
+        if (!perfMon_) {
+            perfMon_ = &tiley::perfmon(perfTag_);
+        }
+        perfMon = perfMon_;
+    }
+
+    // resolve pointer motion batched since the last frame, it may start layout changes
+    static_cast<Pointer*>(seat()->pointer())->flushPendingMotion();
+
+    // apply layout changes accumulated since the last frame before anything is drawn
+    TileyWindowStateManager::getInstance().flushScheduledReflows();
+
+    // the damage of inputs handled so far(including the motion flushed above) is painted by this frame
+    if (perfMon && m_inFlightInputCount < m_inFlightInputs.size()) {
+        if (const UInt32 inputUs = m_pendingInputUs.exchange(0, std::memory_order_acquire)) {
+            m_inFlightInputs[m_inFlightInputCount++] = {paintEventId(), inputUs};
+        }
+    }
+
+    // Louvre may have used the context since the last frame(cursor, screenshots...), start from a clean shadow
+    m_renderResources->state.invalidate();
 
     Surface* fullscreenSurface{ searchFullscreenSurface() };
 
@@ -100,9 +134,10 @@ void Output::paintGL(){
         setContentType(fullscreenSurface->contentType());
         enableVSync(fullscreenSurface->preferVSync());
         enableFractionalOversampling(false);
+        // the scene is skipped below, the frame is still counted by perfmon
         if(tryDirectScanout(fullscreenSurface)){    
             directScanout = true;
-            return;
+            m_directScanout = true;
         }
     }else{
         setContentType(Louvre::LContentTypeNone);
@@ -111,19 +146,29 @@ void Output::paintGL(){
 
     TileyServer& server = TileyServer::getInstance();
 
-
     if (!fullscreenSurface || !directScanout) {
-        perfMon_->renderStart();
-        server.scene().handlePaintGL(this);
+        // the framebuffer content is unknown after scanning out a client buffer, repaint everything once
+        if (m_directScanout) {
+            m_directScanout = false;
+            server.scene().mainView()->damageAll(this);
+        }
+        server.damage().flush(this);
+        if (perfMon) perfMon->renderStart();
+        {
+            TILEY_TRACE_ZONE("Scene::handlePaintGL");
+            server.scene().handlePaintGL(this);
+        }
+        // windows not drawn yet because nothing was painted above them
+        m_renderResources->decorations.flush(painter(), m_renderResources->state);
         //LLog::debug("testing paintGL");
-        perfMon_->renderEnd();
+        if (perfMon) perfMon->renderEnd();
     }
 
     for(LScreenshotRequest * req : screenshotRequests()){
         req->accept(true);
     }
-  
-    perfMon_->recordFrame();
+
+    if (perfMon) perfMon->recordFrame();
 
     // check wallpaper pending update status
     if (WallpaperManager::getInstance().wallpaperChanged()) {
@@ -136,7 +181,11 @@ void Output::moveGL(){
    TileyServer& server = TileyServer::getInstance();
    server.scene().handleMoveGL(this);
 
+   // indexes cover the output rect and surfaces may follow the output
+   SurfaceIndex::invalidateAll();
+   updateDecorationFlushView();
    updateWallpaper();
+   TileyWindowStateManager::getInstance().markStateChanged();
 };
 
 // access real size of screen from here, not initializeGL
@@ -149,14 +198,78 @@ void Output::resizeGL(){
     
     server.scene().handleResizeGL(this);
 
+    SurfaceIndex::invalidateAll();
+    updateDecorationFlushView();
     updateWallpaper();
+    TileyWindowStateManager::getInstance().markStateChanged();
 };
 
 void Output::uninitializeGL(){
     TileyServer& server = TileyServer::getInstance();
     server.scene().handleUninitializeGL(this);
+    m_decorationFlushView.setParent(nullptr);
+    server.damage().forget(this);
+    m_renderResources = nullptr;
+    server.releaseRenderState(this);
+    SurfaceIndex::invalidateAll();
+    TileyWindowStateManager::getInstance().markStateChanged();
 };
 
+void Output::markInput(UInt32 us){
+    if (!tiley::perfmonEnabled() || us == 0) {
+        return;
+    }
+    // keep the oldest input: it waited the longest for this output
+    UInt32 none = 0;
+    m_pendingInputUs.compare_exchange_strong(none, us, std::memory_order_release, std::memory_order_relaxed);
+}
+
+void Output::presented(const LPresentationTime& info){
+    LOutput::presented(info);
+
+    const UInt32 inputUs = takeInFlightInput(info.paintEventId);
+    if (!inputUs) {
+        return;
+    }
+
+    // page-flip time, on the monotonic clock of input event timestamps(see LTime::us()), which wrap around at 32 bits:
+    // the difference does not
+    const UInt32 presentedUs = (UInt32)((UInt64)info.time.tv_sec * 1000000 + (UInt64)info.time.tv_nsec / 1000);
+    const UInt32 latencyUs = presentedUs - inputUs;
+    // timestamps of another clock(e.g. events forwarded by a parent compositor) are ignored
+    if (perfMon_ && tiley::perfmonEnabled() && latencyUs > 0 && latencyUs < 1000000) {
+        perfMon_->recordInputLatency(latencyUs / 1e6);
+    }
+}
+
+void Output::discarded(UInt64 paintEventId){
+    LOutput::discarded(paintEventId);
+
+    // never shown: the input is carried by the next frame, keeping the oldest one
+    if (const UInt32 inputUs = takeInFlightInput(paintEventId)) {
+        m_pendingInputUs.store(inputUs, std::memory_order_release);
+    }
+}
+
+UInt32 Output::takeInFlightInput(UInt64 paintEventId){
+    for (size_t i = 0; i < m_inFlightInputCount; i++) {
+        if (m_inFlightInputs[i].paintEventId != paintEventId) {
+            continue;
+        }
+        const UInt32 inputUs = m_inFlightInputs[i].us;
+        // feedback comes in paint order, frames before this one will not get any
+        m_inFlightInputCount -= i + 1;
+        std::copy_n(m_inFlightInputs.begin() + i + 1, m_inFlightInputCount, m_inFlightInputs.begin());
+        return inputUs;
+    }
+    return 0;
+}
+
+void Output::updateDecorationFlushView(){
+    m_decorationFlushView.setPos(pos());
+    m_decorationFlushView.setSize(size());
+}
+
 void Output::setGammaRequest(LClient* client, const LGammaTable* gamma){
     L_UNUSED(client);
     setGamma(gamma);
@@ -164,12 +277,61 @@ void Output::setGammaRequest(LClient* client, const LGammaTable* gamma){
 
 void Output::availableGeometryChanged(){
     LOutput::availableGeometryChanged();
+    // exclusive zones changed, tiled windows get moved
+    SurfaceIndex::invalidateAll();
 };
 
 
 bool Output::tryDirectScanout(Surface* surface) noexcept{
-    L_UNUSED(surface);
-    return false;
+    if(!surface || !surface->mapped() || surface->minimized() || !surface->toplevel() ||
+       !surface->toplevel()->fullscreen() || surface->toplevel()->exclusiveOutput() != this){
+        return false;
+    }
+
+    // anything composited on top of the surface needs the scene
+    if(!screenshotRequests().empty() ||                                 // screenshots read the composited frame
+       surface->hasMappedChildSurface() ||                              // subsurfaces, popups
+       fadeInView.parent() ||                                           // plug-in animation running
+       (cursor()->visible() && !cursor()->hwCompositingEnabled(this)) ||  // software cursor
+       (seat()->dnd()->dragging() && seat()->dnd()->icon())){           // drag icon
+        return false;
+    }
+
+    // the surface has to cover the whole output exactly as it is, the plane does not scale nor move the buffer
+    if(surface->pos() != pos() || surface->size() != size() || surface->bufferScale() != scale() ||
+       surface->bufferTransform() != transform()){
+        return false;
+    }
+
+    // visible on this output and not a child of the window(those are checked above)
+    const auto coversOutput = [this](LSurface* s){
+        return s->mapped() && !s->minimized() &&
+               s->pos().x() < pos().x() + size().w() && s->pos().x() + s->size().w() > pos().x() &&
+               s->pos().y() < pos().y() + size().h() && s->pos().y() + s->size().h() > pos().y();
+    };
+
+    // overlays and notifications
+    for(LSurface* s : compositor()->layer(LLayerOverlay)){
+        if(coversOutput(s)){
+            return false;
+        }
+    }
+
+    // surfaces of the same layer stacked above the window
+    for(auto it = compositor()->layer(LLayerTop).rbegin(); it != compositor()->layer(LLayerTop).rend() && *it != surface; it++){
+        if(coversOutput(*it)){
+            return false;
+        }
+    }
+
+    // Louvre checks the buffer is compatible with the primary plane(DMA buffer, size, format) and only keeps it for this frame
+    if(!setCustomScanoutBuffer(surface->texture())){
+        return false;
+    }
+
+    // the scene is skipped, the client still has to be told when to draw its next frame
+    surface->requestNextFrame();
+    return true;
 }
 
 Surface* Output::searchFullscreenSurface() const noexcept{
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "LNamespaces.h"
+#include "src/lib/client/views/DecorationFlushView.hpp"
+#include "src/lib/input/SurfaceIndex.hpp"
 #include "src/lib/surface/Surface.hpp"
 #include "src/lib/TileyServer.hpp"
 #include "src/lib/types.hpp"
@@ -8,6 +10,8 @@
 #include <LOutput.h>
 #include <LSolidColorView.h>
 #include <LTextureView.h>
+#include <array>
+#include <atomic>
 #include "src/test/PerformanceMonitor.hpp" 
 
 using namespace Louvre;
@@ -51,17 +55,51 @@ namespace tiley{
             Surface *searchFullscreenSurface() const noexcept;
             bool tryDirectScanout(Surface *surface) noexcept;
 
+            // renderResources: GL state shadow and batched windows of this output's context, nullptr outside of
+            // initializeGL/uninitializeGL. See `TileyServer::renderResources`
+            inline TileyServer::OutputRenderResources* renderResources() const { return m_renderResources; }
+
+            // surfaceIndex: surfaces on this output for pointer hit-testing, see `Pointer::surfaceAtWithFilter`
+            inline SurfaceIndex& surfaceIndex() { return m_surfaceIndex; }
+
             // wallpaper
             void updateWallpaper();
             Louvre::LTextureView& wallpaperView() { return m_wallpaperView; }
             // print wallpaper information
             void printWallpaperInfo();
       
-            // testing instrument
+            // markInput: an input(`us`: its event timestamp, see LInputEvent::us()) damaged this output, its
+            // input-to-photon latency is measured once the frame painting that damage is presented. Perfmon must be enabled
+            void markInput(UInt32 us);
+
+            // presentation feedback of painted frames, closes input latency measurements
+            void presented(const LPresentationTime& info) override;
+            void discarded(UInt64 paintEventId) override;
+
+            // testing instrument: monitor tag(output name) and its monitor, created on first enabled frame
             std::string perfTag_;
             PerformanceMonitor* perfMon_ = nullptr; 
 
         private:
+            // updateDecorationFlushView: keep the flush view covering the output
+            void updateDecorationFlushView();
+
+            SurfaceIndex m_surfaceIndex;
+            TileyServer::OutputRenderResources* m_renderResources = nullptr;
+            // the last frame was a client buffer scanned out directly
+            bool m_directScanout = false;
+            // earliest input not picked up by a frame yet(main thread -> render thread), 0 if none
+            std::atomic<UInt32> m_pendingInputUs{0};
+            // inputs picked up by painted frames, waiting for their presentation feedback(render thread only)
+            struct InFlightInput{
+                UInt64 paintEventId;
+                UInt32 us;
+            };
+            std::array<InFlightInput, 4> m_inFlightInputs;
+            size_t m_inFlightInputCount = 0;
+            // takeInFlightInput: remove the input painted by `paintEventId` and return its timestamp, 0 if none
+            UInt32 takeInFlightInput(UInt64 paintEventId);
+            DecorationFlushView m_decorationFlushView;
             LTextureView m_wallpaperView{nullptr, &TileyServer::getInstance().layers()[BACKGROUND_LAYER]};
     };
 }
\ No newline at end of file
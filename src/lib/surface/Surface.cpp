@@ -1,4 +1,5 @@
 #include "Surface.hpp"
+#include "src/lib/input/SurfaceIndex.hpp"
 
 #include <cmath>
 
@@ -24,6 +25,8 @@
 #include "src/lib/TileyWindowStateManager.hpp"
 #include "src/lib/client/ToplevelRole.hpp"
 #include "src/lib/client/views/SurfaceView.hpp"
+#include "src/lib/ipc/IPCManager.hpp"
+#include "src/lib/output/Output.hpp"
 #include "src/lib/types.hpp"
 #include "src/lib/Utils.hpp"
 
@@ -148,16 +151,16 @@ void Surface::startUnmappedAnimation() noexcept
             const float opacity = 1.f - ease;
             fadeOutView->setOpacity(opacity);
 
-            compositor()->repaintAllOutputs();
+            // the view only shrinks, its initial rect covers every frame
+            TileyServer::getInstance().damage().add(LRect(initialPos, fadeOutView->size()));
         },
-        [fadeOutView, weakSelf](LAnimation *) {
+        [fadeOutView, weakSelf, initialPos](LAnimation *) {
 
             if (fadeOutView) {
+                TileyServer::getInstance().damage().add(LRect(initialPos, fadeOutView->size()));
                 delete fadeOutView->texture();
                 delete fadeOutView;
             }
-
-            compositor()->repaintAllOutputs();
         }
     );
 }
@@ -199,6 +202,10 @@ Surface::Surface(const void *params) : LSurface(params){
     });
 }
 
+Surface::~Surface(){
+    // never leave a dangling surface in pointer indexes
+    SurfaceIndex::invalidateAll();
+}
 
 LView* Surface::getView() noexcept{
 
@@ -214,6 +221,16 @@ LSurfaceView* Surface::getSurfaceView() noexcept{
     return view.get();
 }
 
+bool Surface::hasMappedChildSurface() const noexcept{
+    // subsurfaces and popups are composited on top of the surface
+    for(LSurface* child : children()){
+        if(child->mapped()){
+            return true;
+        }
+    }
+    return false;
+}
+
 void Surface::printWindowGeometryDebugInfo(LOutput* activeOutput, const LRect& outputAvailable) noexcept{
     if(toplevel()){
         const LMargins& margin = toplevel()->extraGeometry();
@@ -238,6 +255,7 @@ void Surface::printWindowGeometryDebugInfo(LOutput* activeOutput, const LRect& o
 // path: roleChanged() -> orderChanged -> ((if window) -> configureRequest() -> atomsChanged()) -> mappingChanged 
 void Surface::roleChanged(LBaseSurfaceRole *prevRole){
     LSurface::roleChanged(prevRole);
+    SurfaceIndex::invalidateAll();
     TileyServer& server = TileyServer::getInstance();
 
     if(cursorRole()){
@@ -253,6 +271,8 @@ void Surface::roleChanged(LBaseSurfaceRole *prevRole){
 // orderChanged: adjust views order to align surfaces order
 void Surface::orderChanged()
 {   
+    SurfaceIndex::invalidateAll();
+
     //LLog::debug("Order Changed, address of surface object: %d, layer: %d", this, layer());
     
     // debug: print order of surfaces
@@ -285,6 +305,7 @@ void Surface::orderChanged()
 
 // move surface of toplevel is enough, subsurfaces will follow as Louvre handles this
 void Surface::layerChanged(){
+    SurfaceIndex::invalidateAll();
     //LLog::debug("%d: Layer changed: ", this);
     TileyServer& server = TileyServer::getInstance();
     getView()->setParent(&server.layers()[layer()]);
@@ -293,10 +314,13 @@ void Surface::layerChanged(){
 // A Surface changed its mapping state, we do layout management here
 void Surface::mappingChanged(){
 
+    SurfaceIndex::invalidateAll();
+
     TileyWindowStateManager& manager = TileyWindowStateManager::getInstance();
     TileyServer& server = TileyServer::getInstance();
 
-    compositor()->repaintAllOutputs();
+    // where the surface appears or disappears, layout changes damage their own areas
+    server.damage().add(LRect(pos(), size()));
 
     if(mapped()){
         // if the surface is not a toplevel, stop processing as parent is defined in constructor
@@ -308,6 +332,7 @@ void Surface::mappingChanged(){
 
         Container* tiledContainer = nullptr;
         manager.addWindow(tl(), tiledContainer);
+        IPCManager::getInstance().broadcastWindowEvent(tl(), "new");
         
         // if inserted successfully
         if(tiledContainer){
@@ -317,7 +342,7 @@ void Surface::mappingChanged(){
             manager.setActiveContainer(tiledContainer);
             LLog::debug("[mappingChanged]: set active container to newly added window");
 
-            manager.recalculate();
+            manager.scheduleRecalculate();
         }
 
         // play animation
@@ -332,11 +357,13 @@ void Surface::mappingChanged(){
                 startUnmappedAnimation();
             }
             
+            IPCManager::getInstance().broadcastWindowEvent(tl(), "close");
+
             // remove window(suitable for all type of windows, including floating ones)
-            Container* siblingContainer = nullptr;
+            LayoutNode* siblingContainer = nullptr;
             manager.removeWindow(tl(), siblingContainer);
             if(siblingContainer != nullptr){
-                manager.recalculate();
+                manager.scheduleRecalculate();
             }
         }
 
@@ -351,6 +378,32 @@ void Surface::mappingChanged(){
     
 }
 
+void Surface::bufferSizeChanged(){
+    LSurface::bufferSizeChanged();
+    // indexed bounds use the surface size
+    SurfaceIndex::invalidateAll();
+}
+
+void Surface::damageChanged(){
+    LSurface::damageChanged();
+
+    if(!m_inputUs){
+        return;
+    }
+    for(LOutput* output : outputs()){
+        static_cast<Output*>(output)->markInput(m_inputUs);
+    }
+    m_inputUs = 0;
+}
+
+void Surface::markInput(UInt32 us) noexcept{
+    if(!m_inputUs && tiley::perfmonEnabled()){
+        m_inputUs = us;
+    }
+}
+
 void Surface::minimizedChanged(){
     LSurface::minimizedChanged();
+    SurfaceIndex::invalidateAll();
+    TileyWindowStateManager::getInstance().markStateChanged();
 }
\ No newline at end of file
@@ -25,6 +25,7 @@ namespace tiley{
         public:
             using LSurface::LSurface;
             Surface(const void *params);
+            ~Surface();
 
             friend Container;
 
@@ -41,6 +42,11 @@ namespace tiley{
             void orderChanged() override;
             void mappingChanged() override;
             void minimizedChanged() override;
+            void bufferSizeChanged() override;
+            void damageChanged() override;
+            // markInput: an input(`us`: its event timestamp) was sent to this surface, the next damage it commits is
+            // its result and gets measured by the outputs showing it(see Output::markInput)
+            void markInput(UInt32 us) noexcept;
             LTexture* renderThumbnail(LRegion* transRegion = nullptr);
 
             void printWindowGeometryDebugInfo(LOutput* activeOutput, const LRect& outputAvailable) noexcept;
@@ -56,5 +62,7 @@ namespace tiley{
             bool isClosing = false;
             // for window snapshot(e.g. before unmapping a window)
             LRect minimizeStartRect;
+            // earliest input sent since the last damage, 0 if none
+            UInt32 m_inputUs = 0;
     };
 }
\ No newline at end of file
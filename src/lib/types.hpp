@@ -3,6 +3,8 @@
 #include "LNamespaces.h"
 #include <LBox.h>
 
+#include "src/lib/layout/LayoutTypes.hpp"
+
 using namespace Louvre;
 
 namespace tiley{
@@ -14,6 +16,7 @@ namespace tiley{
     struct LaunchArgs{
         bool enableDebug;  
         char* startupCMD;  // bash command
+        const char* perfmonSinks;  // perf monitoring sinks, nullptr if not given
     };
 
     // Bottom to top
@@ -25,13 +28,6 @@ namespace tiley{
         OVERLAY_LAYER,  // Lock screen, monitor-wise animation
     };
 
-    // Container split types
-    enum SPLIT_TYPE{
-        SPLIT_NONE,  // window
-        SPLIT_H,
-        SPLIT_V
-    };
-
     // Why if a window is floating
     enum FLOATING_REASON{
         NONE,       // not float
@@ -0,0 +1,195 @@
+// tiley-layout-bench: headless benchmark of the tiling layout engine.
+// Builds trees with 10 to 10,000 leaves and reports the cost of insert, remove, reflow and resize per operation.
+//
+// usage: tiley-layout-bench [--csv] [--rounds N]
+
+#include "src/lib/layout/LayoutEngine.hpp"
+#include "src/lib/layout/LayoutNode.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace tiley;
+
+namespace {
+
+    // A leaf standing for a window, counts applied geometries so that reflow cannot be optimized away
+    class BenchLeaf final : public LayoutNode{
+        public:
+            std::uint64_t applied = 0;
+        protected:
+            void geometryChanged() override { applied++; }
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Result{
+        const char* operation;
+        std::uint32_t leaves;
+        std::uint64_t operations;
+        double nsPerOperation;
+    };
+
+    // available geometry of a 4K output
+    constexpr LayoutRect OUTPUT_AREA {0, 0, 3840, 2160};
+
+    double elapsedNs(Clock::time_point start, Clock::time_point end){
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    struct Workspace{
+        LayoutNode* root = LayoutEngine::createRoot();
+        std::vector<std::unique_ptr<BenchLeaf>> leaves;
+
+        Workspace() = default;
+        Workspace(const Workspace&) = delete;
+        Workspace& operator=(const Workspace&) = delete;
+        ~Workspace(){ LayoutEngine::destroyRoot(root); }
+    };
+
+    // insert a leaf the way the compositor does: split a random window along its longer side
+    void insertLeaf(Workspace& ws, std::mt19937& rng){
+        auto leaf = std::make_unique<BenchLeaf>();
+
+        if(ws.leaves.empty()){
+            LayoutEngine::insertToRoot(ws.root, leaf.get());
+        }else{
+            std::uniform_int_distribution<std::size_t> pick(0, ws.leaves.size() - 1);
+            LayoutNode* target = ws.leaves[pick(rng)].get();
+            const LayoutRect& geo = target->geometry();
+            SPLIT_TYPE split = geo.w >= geo.h ? SPLIT_H : SPLIT_V;
+            LayoutPoint hint {geo.x + geo.w * 0.75f, geo.y + geo.h * 0.75f};
+            LayoutEngine::insert(target, leaf.get(), split, 0.5f, hint);
+        }
+
+        ws.leaves.push_back(std::move(leaf));
+    }
+
+    void benchmarkSize(std::uint32_t leafCount, std::uint32_t rounds, std::vector<Result>& results){
+
+        std::mt19937 rng(leafCount);
+        std::uint64_t checksum = 0;
+
+        double insertNs = 0, removeNs = 0, reflowNs = 0, resizeNs = 0;
+        std::uint64_t inserts = 0, removes = 0, reflows = 0, resizes = 0;
+
+        for(std::uint32_t round = 0; round < rounds; round++){
+
+            Workspace ws;
+
+            // insert: build the whole tree, reflowing once in a while to keep target geometries meaningful
+            for(std::uint32_t i = 0; i < leafCount; i++){
+                auto start = Clock::now();
+                insertLeaf(ws, rng);
+                insertNs += elapsedNs(start, Clock::now());
+                inserts++;
+
+                if((i & (i + 1)) == 0){
+                    LayoutEngine::reflow(ws.root, OUTPUT_AREA);
+                }
+            }
+
+            // reflow: full workspace recalculation, the available area changes every time(e.g. output resized)
+            const std::uint32_t reflowRepeats = std::max<std::uint32_t>(1, 100000 / leafCount);
+            for(std::uint32_t i = 0; i < reflowRepeats; i++){
+                LayoutRect area = OUTPUT_AREA;
+                area.w -= (i & 1);
+                auto start = Clock::now();
+                checksum += LayoutEngine::reflow(ws.root, area);
+                reflowNs += elapsedNs(start, Clock::now());
+                reflows++;
+            }
+
+            LayoutEngine::reflow(ws.root, OUTPUT_AREA);
+
+            // resize: one pointer move of a tiled resize(move a split line, then re-layout the affected subtree)
+            std::vector<LayoutNode*> splits;
+            for(auto& leaf : ws.leaves){
+                if(leaf->parent() && leaf->parent() != ws.root){
+                    splits.push_back(leaf->parent());
+                }
+            }
+            if(!splits.empty()){
+                std::uniform_int_distribution<std::size_t> pick(0, splits.size() - 1);
+                std::uniform_real_distribution<double> delta(-200.0, 200.0);
+                for(std::uint32_t i = 0; i < reflowRepeats; i++){
+                    LayoutNode* target = splits[pick(rng)];
+                    auto start = Clock::now();
+                    LayoutEngine::resize(target, target->splitRatio(), delta(rng));
+                    checksum += LayoutEngine::reflow(ws.root, OUTPUT_AREA);
+                    resizeNs += elapsedNs(start, Clock::now());
+                    resizes++;
+                }
+            }
+
+            // remove: close windows in random order until the workspace is empty
+            std::shuffle(ws.leaves.begin(), ws.leaves.end(), rng);
+            while(!ws.leaves.empty()){
+                std::uint32_t removed = 0;
+                auto start = Clock::now();
+                LayoutEngine::detach(ws.leaves.back().get(), removed);
+                removeNs += elapsedNs(start, Clock::now());
+                removes++;
+                checksum += ws.leaves.back()->applied + removed;
+                ws.leaves.pop_back();
+            }
+        }
+
+        results.push_back({"insert", leafCount, inserts, insertNs / inserts});
+        results.push_back({"remove", leafCount, removes, removeNs / removes});
+        results.push_back({"reflow", leafCount, reflows, reflowNs / reflows});
+        if(resizes){
+            results.push_back({"resize", leafCount, resizes, resizeNs / resizes});
+        }
+
+        // keep the optimizer honest
+        if(checksum == 0){
+            std::fprintf(stderr, "[tiley-layout-bench]: unexpected empty checksum\n");
+        }
+    }
+}
+
+int main(int argc, char* argv[]){
+
+    bool csv = false;
+    std::uint32_t rounds = 3;
+
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "--csv") == 0){
+            csv = true;
+        }else if(std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc){
+            rounds = std::max(1, std::atoi(argv[++i]));
+        }else{
+            std::fprintf(stderr, "usage: %s [--csv] [--rounds N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::uint32_t sizes[] = {10, 100, 1000, 10000};
+    std::vector<Result> results;
+
+    for(std::uint32_t size : sizes){
+        benchmarkSize(size, rounds, results);
+    }
+
+    if(csv){
+        std::printf("operation,leaves,operations,ns_per_op\n");
+        for(const Result& r : results){
+            std::printf("%s,%u,%llu,%.1f\n", r.operation, r.leaves, (unsigned long long)r.operations, r.nsPerOperation);
+        }
+    }else{
+        std::printf("%-8s %8s %12s %14s\n", "op", "leaves", "ops", "ns/op");
+        for(const Result& r : results){
+            std::printf("%-8s %8u %12llu %14.1f\n", r.operation, r.leaves, (unsigned long long)r.operations, r.nsPerOperation);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,52 +1,235 @@
 #include "PerfmonRegistry.hpp"
 #include "PerformanceMonitor.hpp"
+#include "PerfmonSink.hpp"
+#include "TraceZone.hpp"
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <sstream>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
 #include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace tiley {
 
+namespace detail {
+    std::atomic<bool> perfmon_enabled{false};
+}
+
 static std::unordered_map<std::string, std::unique_ptr<PerformanceMonitor>> g_registry;
-static std::unordered_map<std::string, std::string> g_path_override;
 static std::mutex g_mu;
 
-static std::string default_path_for(const std::string& tag) {
-    // TODO: hard-coded path
-    return "/home/zero/tiley/src/lib/test_" + tag + ".txt";
-}
+// Consumers of the monitors: whoever holds g_sink_mu may drain them
+static std::vector<std::unique_ptr<PerfmonSink>> g_sinks;
+static unsigned g_sink_flags = PERFMON_SINK_NONE;
+static std::mutex g_sink_mu;
 
-PerformanceMonitor& perfmon(const std::string& tag) {
+static std::once_flag g_stream_fd_once;
+static int g_stream_fd = -1;
+
+static std::vector<PerformanceMonitor*> snapshotMonitors() {
+    std::vector<PerformanceMonitor*> monitors;
     std::lock_guard<std::mutex> lk(g_mu);
+    monitors.reserve(g_registry.size());
+    for (auto& [tag, monitor] : g_registry) {
+        monitors.push_back(monitor.get());
+    }
+    return monitors;
+}
 
-    auto it = g_registry.find(tag);
-    if (it == g_registry.end()) {
-        // Solve Path: Overriding first, followed by rule
-        //TODO: Get dir by name
-        std::string path;
-        auto pit = g_path_override.find(tag);
-        if (pit != g_path_override.end()) {
-            path = pit->second;
+// Caller holds g_sink_mu
+static void drainMonitors(const std::vector<PerformanceMonitor*>& monitors) {
+    for (PerformanceMonitor* monitor : monitors) {
+        monitor->drain(g_sinks);
+    }
+    drainTraceZones(g_sinks);
+    for (const auto& sink : g_sinks) {
+        sink->flush();
+    }
+}
+
+// Background thread draining every monitor, all statistics and file I/O happen here instead of the render threads
+class PerfmonFlusher {
+public:
+    ~PerfmonFlusher() { stop(); }
+
+    void ensureStarted() {
+        std::lock_guard<std::mutex> lk(wake_mu_);
+        if (running_) {
+            return;
+        }
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        running_ = true;
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lk(wake_mu_);
+            running_ = false;
+        }
+        wake_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    static constexpr std::chrono::milliseconds INTERVAL{250};
+
+    void run() {
+        std::unique_lock<std::mutex> wake_lk(wake_mu_);
+        while (running_) {
+            wake_lk.unlock();
+            {
+                // Monitors are never destroyed while the flusher runs, drain without blocking perfmon()
+                const std::vector<PerformanceMonitor*> monitors = snapshotMonitors();
+                std::lock_guard<std::mutex> lk(g_sink_mu);
+                drainMonitors(monitors);
+            }
+            wake_lk.lock();
+            wake_.wait_for(wake_lk, INTERVAL, [this]() { return !running_; });
+        }
+    }
+
+    std::thread thread_;
+    std::mutex wake_mu_;
+    std::condition_variable wake_;
+    bool running_ = false;
+};
+
+// Declared after the registry and the sinks: destroyed(and joined) first at exit
+static PerfmonFlusher g_flusher;
+
+static std::string perfmonDirectory() {
+    if (const char* dir = getenv("TILEY_PERFMON_DIR")) {
+        return dir;
+    }
+    const char* xdg_runtime = getenv("XDG_RUNTIME_DIR");
+    return std::string(xdg_runtime ? xdg_runtime : "/tmp") + "/tiley-perfmon";
+}
+
+bool parsePerfmonSinks(const std::string& spec, unsigned& sinks) {
+    unsigned result = PERFMON_SINK_NONE;
+    std::stringstream ss(spec);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name.empty() || name == "off" || name == "0") {
+            continue;
+        } else if (name == "csv" || name == "on" || name == "1") {
+            result |= PERFMON_SINK_CSV;
+        } else if (name == "trace") {
+            result |= PERFMON_SINK_TRACE;
+        } else if (name == "ipc") {
+            result |= PERFMON_SINK_IPC;
+        } else if (name == "zones") {
+            result |= PERFMON_SINK_ZONES;
+        } else if (name == "all") {
+            result |= PERFMON_SINK_CSV | PERFMON_SINK_TRACE | PERFMON_SINK_IPC | PERFMON_SINK_ZONES;
         } else {
-            path = default_path_for(tag);
+            return false;
         }
+    }
+    sinks = result;
+    return true;
+}
+
+std::string perfmonSinksToString(unsigned sinks) {
+    std::string result;
+    const auto append = [&result](const char* name) {
+        if (!result.empty()) {
+            result += ',';
+        }
+        result += name;
+    };
+    if (sinks & PERFMON_SINK_CSV) append("csv");
+    if (sinks & PERFMON_SINK_TRACE) append("trace");
+    if (sinks & PERFMON_SINK_IPC) append("ipc");
+    if (sinks & PERFMON_SINK_ZONES) append("zones");
+    return result.empty() ? "off" : result;
+}
 
-        auto ins = g_registry.emplace(tag, std::make_unique<PerformanceMonitor>(path));
-        return *(ins.first->second);
+void setPerfmonSinks(unsigned sinks) {
+    if (sinks == PERFMON_SINK_NONE) {
+        // Off costs nothing: producers stop first, then the flusher is joined(outside g_sink_mu, which it takes).
+        // The final drain below picks up what was queued meanwhile
+        detail::perfmon_enabled.store(false, std::memory_order_relaxed);
+        detail::zones_enabled.store(false, std::memory_order_relaxed);
+        g_flusher.stop();
     }
-    return *(it->second);
+
+    const std::vector<PerformanceMonitor*> monitors = snapshotMonitors();
+
+    std::lock_guard<std::mutex> lk(g_sink_mu);
+    if (sinks == g_sink_flags) {
+        return;
+    }
+
+    // Frames queued so far belong to the old configuration
+    drainMonitors(monitors);
+    g_sinks.clear();
+
+    const bool was_enabled = g_sink_flags != PERFMON_SINK_NONE;
+    g_sink_flags = sinks;
+
+    if (sinks & (PERFMON_SINK_CSV | PERFMON_SINK_TRACE | PERFMON_SINK_ZONES)) {
+        const std::string dir = perfmonDirectory();
+        mkdir(dir.c_str(), 0700);
+        if (sinks & PERFMON_SINK_CSV) {
+            g_sinks.push_back(std::make_unique<CsvSink>(dir));
+        }
+        if (sinks & PERFMON_SINK_TRACE) {
+            g_sinks.push_back(std::make_unique<TraceSink>(dir));
+        }
+        if (sinks & PERFMON_SINK_ZONES) {
+            g_sinks.push_back(std::make_unique<ChromeTraceSink>(dir));
+        }
+    }
+    if (sinks & PERFMON_SINK_IPC) {
+        g_sinks.push_back(std::make_unique<IpcStreamSink>(perfmonStreamFd()));
+    }
+
+    if (sinks != PERFMON_SINK_NONE) {
+        // Statistics start over, frames of an earlier session would skew them
+        if (!was_enabled) {
+            for (PerformanceMonitor* monitor : monitors) {
+                monitor->reset();
+            }
+        }
+        g_flusher.ensureStarted();
+    }
+
+    detail::perfmon_enabled.store(sinks != PERFMON_SINK_NONE, std::memory_order_relaxed);
+    detail::zones_enabled.store((sinks & PERFMON_SINK_ZONES) != 0, std::memory_order_relaxed);
+}
+
+unsigned perfmonSinks() {
+    std::lock_guard<std::mutex> lk(g_sink_mu);
+    return g_sink_flags;
 }
 
-//TODO: Dynamically update path
-void setPerfmonPath(const std::string& tag, const std::string& path) {
+int perfmonStreamFd() {
+    std::call_once(g_stream_fd_once, []() {
+        g_stream_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    });
+    return g_stream_fd;
+}
+
+PerformanceMonitor& perfmon(const std::string& tag) {
     std::lock_guard<std::mutex> lk(g_mu);
-    g_path_override[tag] = path;
 
-    // Instance exists, update its path
     auto it = g_registry.find(tag);
-    if (it != g_registry.end() && it->second) {
-        it->second->setPath(path);
+    if (it == g_registry.end()) {
+        it = g_registry.emplace(tag, std::make_unique<PerformanceMonitor>(tag)).first;
     }
+    return *(it->second);
 }
 
 bool hasPerfmon(const std::string& tag) {
@@ -55,9 +238,21 @@ bool hasPerfmon(const std::string& tag) {
 }
 
 void shutdownPerfmons() {
+    detail::perfmon_enabled.store(false, std::memory_order_relaxed);
+    detail::zones_enabled.store(false, std::memory_order_relaxed);
+    g_flusher.stop();
+
+    // Last samples queued since the previous flush
+    const std::vector<PerformanceMonitor*> monitors = snapshotMonitors();
+    {
+        std::lock_guard<std::mutex> lk(g_sink_mu);
+        drainMonitors(monitors);
+        g_sinks.clear();
+        g_sink_flags = PERFMON_SINK_NONE;
+    }
+
     std::lock_guard<std::mutex> lk(g_mu);
     g_registry.clear();
-    g_path_override.clear();
 }
 
 } 
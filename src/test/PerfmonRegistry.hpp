@@ -1,20 +1,47 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 class PerformanceMonitor;
 
 namespace tiley {
 
-
-// Get perf monitor instances by tag
+// Where perf data goes, any combination
+enum PerfmonSinkFlags : unsigned {
+    PERFMON_SINK_NONE  = 0,
+    PERFMON_SINK_CSV   = 1 << 0,  // <dir>/<tag>.csv, one line per report
+    PERFMON_SINK_TRACE = 1 << 1,  // <dir>/perfmon.trace, every frame
+    PERFMON_SINK_IPC   = 1 << 2,  // "perfmon" IPC event subscribers
+    PERFMON_SINK_ZONES = 1 << 3   // <dir>/zones-*.json, TraceZone scopes as Chrome trace events
+};
+
+namespace detail {
+    extern std::atomic<bool> perfmon_enabled;
+}
+
+// Checked by render threads every frame: monitors are only fed while some sink is enabled
+inline bool perfmonEnabled() {
+    return detail::perfmon_enabled.load(std::memory_order_relaxed);
+}
+
+// Parse a sink list: "csv,trace,ipc,zones", "all", "on"(= csv) or "off". Returns false for unknown names
+bool parsePerfmonSinks(const std::string& spec, unsigned& sinks);
+std::string perfmonSinksToString(unsigned sinks);
+
+// Switch sinks at runtime, PERFMON_SINK_NONE turns monitoring off.
+// Files are written to $TILEY_PERFMON_DIR, default $XDG_RUNTIME_DIR/tiley-perfmon
+void setPerfmonSinks(unsigned sinks);
+unsigned perfmonSinks();
+
+// eventfd readable when reports for the IPC stream are pending, see IpcStreamSink::take
+int perfmonStreamFd();
+
+// Get perf monitor instances by tag, created on first use and kept until shutdown
 PerformanceMonitor& perfmon(const std::string& tag);
 
-// Overriding perf log path
-void setPerfmonPath(const std::string& tag, const std::string& path);
-
 bool hasPerfmon(const std::string& tag);
 
-// No need to shutdown before process exits
+// Stop the flusher and write what is left, render threads must be done with their monitors
 void shutdownPerfmons();
 
 } 
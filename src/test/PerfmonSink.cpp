@@ -0,0 +1,157 @@
+#include "PerfmonSink.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace tiley {
+
+CsvSink::CsvSink(const std::string& dir) : dir_(dir) {}
+
+void CsvSink::report(const std::string& tag, const PerfReport& report) {
+    auto it = files_.find(tag);
+    if (it == files_.end()) {
+        it = files_.emplace(tag, std::ofstream(dir_ + "/" + tag + ".csv", std::ios::app)).first;
+        // New file: column names first
+        if (it->second.is_open() && it->second.tellp() == 0) {
+            it->second << "timestamp_ms,fps,cpu_s,cpu_fps_ratio,memory_mb,avg_render_ms,p50_ms,p95_ms,p99_ms,max_ms,dropped,"
+                          "latency_count,latency_p50_ms,latency_p95_ms,latency_p99_ms,latency_max_ms\n";
+        }
+    }
+
+    std::ofstream& file = it->second;
+    if (!file.is_open()) {
+        return;
+    }
+
+    const FrameStats& s = report.stats;
+    const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    file << now << ','
+         << s.fps << ','
+         << report.cpu_seconds << ','
+         << (s.fps != 0 ? report.cpu_seconds / s.fps : 0) << ','
+         << report.memory_mb << ','
+         << s.avg_render_ms << ','
+         << s.p50_ms << ',' << s.p95_ms << ',' << s.p99_ms << ',' << s.max_ms << ','
+         << report.dropped << ','
+         << s.latency_count << ','
+         << s.latency_p50_ms << ',' << s.latency_p95_ms << ',' << s.latency_p99_ms << ',' << s.latency_max_ms << '\n';
+}
+
+void CsvSink::flush() {
+    for (auto& [tag, file] : files_) {
+        file.flush();
+    }
+}
+
+TraceSink::TraceSink(const std::string& dir)
+    : file_(dir + "/perfmon.trace", std::ios::app | std::ios::binary)
+{
+    if (file_.is_open() && file_.tellp() == 0) {
+        file_.write("TLYPERF2", 8);
+    }
+}
+
+void TraceSink::sample(const std::string& tag, const FrameSample& sample) {
+    if (!file_.is_open()) {
+        return;
+    }
+
+    PerfTraceRecord record{};
+    std::strncpy(record.tag, tag.c_str(), sizeof(record.tag) - 1);
+    record.timestamp_ns = sample.timestamp_ns;
+    record.frame_seconds = sample.frame_seconds;
+    record.render_seconds = sample.render_seconds;
+    record.input_latency_seconds = sample.input_latency_seconds;
+    file_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+void TraceSink::flush() {
+    file_.flush();
+}
+
+ChromeTraceSink::ChromeTraceSink(const std::string& dir) : pid_(getpid()) {
+    static int session = 0;
+    file_.open(dir + "/zones-" + std::to_string(pid_) + "-" + std::to_string(session++) + ".json");
+    if (file_.is_open()) {
+        // microseconds with nanosecond resolution
+        file_ << std::fixed << std::setprecision(3) << "[";
+    }
+}
+
+ChromeTraceSink::~ChromeTraceSink() {
+    if (file_.is_open()) {
+        file_ << "\n]\n";
+    }
+}
+
+void ChromeTraceSink::separator() {
+    file_ << (first_ ? "\n" : ",\n");
+    first_ = false;
+}
+
+void ChromeTraceSink::sample(const std::string& tag, const FrameSample& sample) {
+    if (!file_.is_open()) {
+        return;
+    }
+    // Counter track per output, next to the zones of its render thread
+    separator();
+    file_ << "{\"name\":\"" << tag << "\",\"ph\":\"C\",\"pid\":" << pid_
+          << ",\"ts\":" << sample.timestamp_ns / 1000.0
+          << ",\"args\":{\"frame_ms\":" << sample.frame_seconds * 1000.0
+          << ",\"render_ms\":" << sample.render_seconds * 1000.0;
+    if (sample.input_latency_seconds > 0.0) {
+        file_ << ",\"input_latency_ms\":" << sample.input_latency_seconds * 1000.0;
+    }
+    file_ << "}}";
+}
+
+void ChromeTraceSink::zone(std::uint32_t tid, const ZoneEvent& zone) {
+    if (!file_.is_open()) {
+        return;
+    }
+    // Zone names are identifiers written in the code, no escaping needed
+    separator();
+    file_ << "{\"name\":\"" << zone.name << "\",\"ph\":\"X\",\"pid\":" << pid_ << ",\"tid\":" << tid
+          << ",\"ts\":" << zone.start_ns / 1000.0
+          << ",\"dur\":" << (zone.end_ns - zone.start_ns) / 1000.0 << "}";
+}
+
+void ChromeTraceSink::flush() {
+    file_.flush();
+}
+
+static std::mutex g_stream_mu;
+static std::deque<PerfStreamEntry> g_stream;
+
+void IpcStreamSink::report(const std::string& tag, const PerfReport& report) {
+    std::lock_guard<std::mutex> lk(g_stream_mu);
+    if (g_stream.size() == MAX_PENDING) {
+        g_stream.pop_front();
+    }
+    g_stream.push_back({tag, report});
+    notify_ = true;
+}
+
+void IpcStreamSink::flush() {
+    // One wake-up per flush round, not per report
+    if (notify_ && fd_ >= 0) {
+        std::uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = write(fd_, &one, sizeof(one));
+    }
+    notify_ = false;
+}
+
+std::vector<PerfStreamEntry> IpcStreamSink::take() {
+    std::lock_guard<std::mutex> lk(g_stream_mu);
+    std::vector<PerfStreamEntry> entries(std::make_move_iterator(g_stream.begin()), std::make_move_iterator(g_stream.end()));
+    g_stream.clear();
+    return entries;
+}
+
+} 
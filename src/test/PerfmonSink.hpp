@@ -0,0 +1,105 @@
+#pragma once
+
+#include "PerformanceMonitor.hpp"
+#include "TraceZone.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tiley {
+
+// Destination of perf data. Called by the flusher thread only(see PerfmonRegistry)
+class PerfmonSink {
+public:
+    virtual ~PerfmonSink() = default;
+    // Every frame
+    virtual void sample(const std::string& tag, const FrameSample& sample) { (void)tag; (void)sample; }
+    // Every PerformanceMonitor::REPORT_INTERVAL frames
+    virtual void report(const std::string& tag, const PerfReport& report) { (void)tag; (void)report; }
+    // Every TraceZone of thread `tid`
+    virtual void zone(std::uint32_t tid, const ZoneEvent& zone) { (void)tid; (void)zone; }
+    // End of a flush round
+    virtual void flush() {}
+};
+
+// One CSV file per tag: <dir>/<tag>.csv
+class CsvSink final : public PerfmonSink {
+public:
+    explicit CsvSink(const std::string& dir);
+    void report(const std::string& tag, const PerfReport& report) override;
+    void flush() override;
+
+private:
+    std::string dir_;
+    std::unordered_map<std::string, std::ofstream> files_;
+};
+
+// Every frame of every tag in one binary file: <dir>/perfmon.trace
+// Layout: "TLYPERF2" followed by PerfTraceRecord, native endianness
+struct PerfTraceRecord {
+    char tag[24];              // zero padded
+    std::int64_t timestamp_ns; // steady clock
+    double frame_seconds;
+    double render_seconds;
+    double input_latency_seconds; // 0 if the frame presented no input
+};
+
+class TraceSink final : public PerfmonSink {
+public:
+    explicit TraceSink(const std::string& dir);
+    void sample(const std::string& tag, const FrameSample& sample) override;
+    void flush() override;
+
+private:
+    std::ofstream file_;
+};
+
+// Trace zones and frame times in the Chrome trace event format(chrome://tracing, ui.perfetto.dev):
+// <dir>/zones-<pid>-<n>.json, a new file every time the sink is enabled
+class ChromeTraceSink final : public PerfmonSink {
+public:
+    explicit ChromeTraceSink(const std::string& dir);
+    ~ChromeTraceSink() override;
+    void sample(const std::string& tag, const FrameSample& sample) override;
+    void zone(std::uint32_t tid, const ZoneEvent& zone) override;
+    void flush() override;
+
+private:
+    void separator();
+
+    std::ofstream file_;
+    bool first_ = true;
+    int pid_;
+};
+
+struct PerfStreamEntry {
+    std::string tag;
+    PerfReport report;
+};
+
+// Reports handed to the compositor thread, which streams them to IPC subscribers.
+// `fd` is an eventfd, readable while entries are pending.
+class IpcStreamSink final : public PerfmonSink {
+public:
+    explicit IpcStreamSink(int fd) : fd_(fd) {}
+    void report(const std::string& tag, const PerfReport& report) override;
+    void flush() override;
+
+    // Compositor thread
+    static std::vector<PerfStreamEntry> take();
+
+private:
+    // Oldest reports are dropped when nobody reads them
+    static constexpr std::size_t MAX_PENDING = 256;
+
+    int fd_;
+    bool notify_ = false;
+};
+
+} 
@@ -1,75 +1,139 @@
 #include "PerformanceMonitor.hpp"
+#include "PerfmonSink.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 #include <sys/resource.h>
 #include <unistd.h>
 
-PerformanceMonitor::PerformanceMonitor(const std::string& file_path)
-    : file_path_(file_path),
-      frames_(0),
+PerformanceMonitor::PerformanceMonitor(const std::string& tag)
+    : tag_(tag),
       start_time_(std::chrono::steady_clock::now()) // steady_clock: 单调时钟
-{}
-
-// Set monitor output path
-void PerformanceMonitor::setPath(const std::string& p) {
-    file_path_ = p;
+{
+    scratch_.reserve(WINDOW_SIZE);
+    latency_scratch_.reserve(WINDOW_SIZE);
 }
 
 // Render start
 void PerformanceMonitor::renderStart() {
-    render_start_time_= std::chrono::steady_clock::now();
+    render_start_time_ = std::chrono::steady_clock::now();
 }
 
 // Save single frame render time
 void PerformanceMonitor::renderEnd() {
-    auto render_end_time = std::chrono::steady_clock::now();
-    std::chrono::duration<double> render_duration = render_end_time - render_start_time_;
-    render_durations_.push_back(render_duration.count());
+    std::chrono::duration<double> render_duration = std::chrono::steady_clock::now() - render_start_time_;
+    render_seconds_ = render_duration.count();
 }
 
-
-// Accumulating performance data per frame and output once enough
+// Hand the frame over to the flusher
 void PerformanceMonitor::recordFrame() {
-    frames_++;
     auto frame_time = std::chrono::steady_clock::now();
-
     std::chrono::duration<double> elapsed = frame_time - start_time_;
-    double elapsed_seconds = elapsed.count();
-
-    // Idle frames ( > 0.5s idling time) are not counted
-    constexpr double idle_threshold_seconds = 0.5;
-    if (elapsed_seconds <= idle_threshold_seconds) {
-        frame_times_.push_back(elapsed_seconds);
-    }
 
     // Update timestamp
     start_time_ = frame_time;
 
-    if (frames_ % 60 == 0) {
-        logMetrics();
+    const std::int64_t timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(frame_time.time_since_epoch()).count();
+    if (!queue_.push({timestamp_ns, elapsed.count(), render_seconds_, input_latency_seconds_})) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
     }
+    render_seconds_ = 0.0;
+    input_latency_seconds_ = 0.0;
+}
+
+void PerformanceMonitor::recordInputLatency(double seconds) {
+    // Several inputs presented by one frame: the oldest one counts
+    input_latency_seconds_ = std::max(input_latency_seconds_, seconds);
 }
 
-// Log performance data to file
-void PerformanceMonitor::logMetrics() {
-    double cpu_usage       = getCpuUsage();
-    double memory_usage_mb = getMemoryUsage();
-    double fps             = calculateFps();
-    double avg_render_time = calculateAvgRenderTime();
-
-    double cpu_fps_ratio   = fps != 0 ? cpu_usage / fps : 0;
-
-    std::ofstream file(file_path_, std::ios::app);
-    if (file.is_open()) {
-        file << "FPS: " << fps
-             << ", CPU(s): " << cpu_usage
-             << ", CPU/FPS Ratio: " << cpu_fps_ratio
-             << ", Memory(MB): " << memory_usage_mb
-             << ", Avg Render Time (ms): " << avg_render_time * 1000
-             << "\n";
+void PerformanceMonitor::drain(const std::vector<std::unique_ptr<tiley::PerfmonSink>>& sinks) {
+    FrameSample sample;
+    while (queue_.pop(sample)) {
+        window_[window_next_] = sample;
+        window_next_ = (window_next_ + 1) % WINDOW_SIZE;
+        window_count_ = std::min(window_count_ + 1, WINDOW_SIZE);
+
+        for (const auto& sink : sinks) {
+            sink->sample(tag_, sample);
+        }
+
+        if (++frames_ % REPORT_INTERVAL == 0 && !sinks.empty()) {
+            const PerfReport report = makeReport();
+            for (const auto& sink : sinks) {
+                sink->report(tag_, report);
+            }
+        }
     }
 }
 
+void PerformanceMonitor::reset() {
+    window_count_ = 0;
+    window_next_ = 0;
+    frames_ = 0;
+}
+
+// nearest-rank percentile of sorted `values`
+static double percentile(const std::vector<double>& values, double p) {
+    std::size_t rank = (std::size_t)std::ceil(p * values.size());
+    return values[std::clamp<std::size_t>(rank, 1, values.size()) - 1];
+}
+
+FrameStats PerformanceMonitor::stats() {
+    FrameStats result;
+
+    double total_time = 0.0;
+    double total_render = 0.0;
+    scratch_.clear();
+    latency_scratch_.clear();
+    for (std::size_t i = 0; i < window_count_; i++) {
+        const FrameSample& sample = window_[i];
+        total_render += sample.render_seconds;
+        if (sample.frame_seconds <= IDLE_THRESHOLD_SECONDS) {
+            total_time += sample.frame_seconds;
+            scratch_.push_back(sample.frame_seconds * 1000.0);
+        }
+        // frames after idling count here, an input is what ends the idling
+        if (sample.input_latency_seconds > 0.0) {
+            latency_scratch_.push_back(sample.input_latency_seconds * 1000.0);
+        }
+    }
+
+    result.frames = window_count_;
+    result.avg_render_ms = window_count_ ? total_render / window_count_ * 1000.0 : 0.0;
+
+    if (!latency_scratch_.empty()) {
+        std::sort(latency_scratch_.begin(), latency_scratch_.end());
+        result.latency_count = latency_scratch_.size();
+        result.latency_p50_ms = percentile(latency_scratch_, 0.50);
+        result.latency_p95_ms = percentile(latency_scratch_, 0.95);
+        result.latency_p99_ms = percentile(latency_scratch_, 0.99);
+        result.latency_max_ms = latency_scratch_.back();
+    }
+
+    if (scratch_.empty()) {
+        return result;
+    }
+
+    result.fps = total_time > 0.0 ? scratch_.size() / total_time : 0.0;
+
+    std::sort(scratch_.begin(), scratch_.end());
+    result.p50_ms = percentile(scratch_, 0.50);
+    result.p95_ms = percentile(scratch_, 0.95);
+    result.p99_ms = percentile(scratch_, 0.99);
+    result.max_ms = scratch_.back();
+
+    return result;
+}
+
+PerfReport PerformanceMonitor::makeReport() {
+    PerfReport report;
+    report.stats = stats();
+    report.cpu_seconds = getCpuUsage();
+    report.memory_mb = getMemoryUsage();
+    report.dropped = droppedSamples();
+    return report;
+}
+
 // Process CPU time
 double PerformanceMonitor::getCpuUsage() {
     struct rusage usage{};
@@ -83,17 +147,3 @@ double PerformanceMonitor::getMemoryUsage() {
     getrusage(RUSAGE_SELF, &usage);
     return usage.ru_maxrss / 1024.0; // KB → MB
 }
-
-// Average FPS
-double PerformanceMonitor::calculateFps() {
-    double total_time = 0.0;
-    for (double t : frame_times_) total_time += t;
-    return frame_times_.empty() ? 0.0 : frame_times_.size() / total_time;
-}
-
-// Average Render time (seconds)
-double PerformanceMonitor::calculateAvgRenderTime() {
-    double total = 0.0;
-    for (double rt : render_durations_) total += rt;
-    return render_durations_.empty() ? 0.0 : total / render_durations_.size();
-}
@@ -1,31 +1,105 @@
 #pragma once
 
+#include "SpscQueue.hpp"
+
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+namespace tiley {
+    class PerfmonSink;
+}
+
+// One frame as seen by the render thread
+struct FrameSample {
+    std::int64_t timestamp_ns = 0; // steady clock, end of the frame
+    double frame_seconds = 0.0;    // time since the previous frame
+    double render_seconds = 0.0;   // scene painting time, 0 if the scene was skipped
+    double input_latency_seconds = 0.0; // input-to-photon latency presented with this frame, 0 if none
+};
+
+// Statistics over the rolling window
+struct FrameStats {
+    std::size_t frames = 0;
+    double fps = 0.0;
+    double avg_render_ms = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+    // input-to-photon latency of the frames that presented an input
+    std::size_t latency_count = 0;
+    double latency_p50_ms = 0.0;
+    double latency_p95_ms = 0.0;
+    double latency_p99_ms = 0.0;
+    double latency_max_ms = 0.0;
+};
+
+// What sinks receive every REPORT_INTERVAL frames
+struct PerfReport {
+    FrameStats stats;
+    double cpu_seconds = 0.0;
+    double memory_mb = 0.0;
+    std::size_t dropped = 0;
+};
+
+// Frame timing of one output.
+// The render thread only stamps times and pushes a sample into a fixed-size lock-free queue(renderStart/renderEnd/recordFrame).
+// The perfmon flusher thread(see PerfmonRegistry) drains it into a rolling window, computes statistics and feeds the sinks.
 class PerformanceMonitor {
 public:
-    explicit PerformanceMonitor(const std::string& file_path);
-    void setPath(const std::string& p);
+    explicit PerformanceMonitor(const std::string& tag);
+
+    const std::string& tag() const { return tag_; }
+
+    // Render thread: no allocation, no lock, no I/O
     void renderStart();
     void renderEnd();
     void recordFrame();
+    // An input reached the screen `seconds` after it happened, reported with the next recorded frame
+    void recordInputLatency(double seconds);
+
+    // Flusher thread: consume queued samples, report every REPORT_INTERVAL frames
+    void drain(const std::vector<std::unique_ptr<tiley::PerfmonSink>>& sinks);
+    // Flusher thread: forget the rolling window(e.g. monitoring was switched off for a while)
+    void reset();
+    // Statistics of the rolling window, flusher thread only
+    FrameStats stats();
+
+    // Samples lost because the flusher fell behind
+    std::size_t droppedSamples() const { return dropped_.load(std::memory_order_relaxed); }
 
 private:
-    void logMetrics();
+    static constexpr std::size_t QUEUE_CAPACITY = 1024;
+    static constexpr std::size_t WINDOW_SIZE = 600;       // ~10s at 60Hz
+    static constexpr std::size_t REPORT_INTERVAL = 60;
+    // Idle frames ( > 0.5s idling time) are not counted
+    static constexpr double IDLE_THRESHOLD_SECONDS = 0.5;
+
+    PerfReport makeReport();
     double getCpuUsage();
     double getMemoryUsage();
-    double calculateFps();
-    double calculateAvgRenderTime();
-
-    std::string file_path_;
-    size_t frames_;
 
+    const std::string tag_;
 
+    // render thread
     std::chrono::steady_clock::time_point start_time_;
     std::chrono::steady_clock::time_point render_start_time_;
+    double render_seconds_ = 0.0;
+    double input_latency_seconds_ = 0.0;
+    SpscQueue<FrameSample, QUEUE_CAPACITY> queue_;
+    std::atomic<std::size_t> dropped_{0};
 
-    std::vector<double> frame_times_;
-    std::vector<double> render_durations_;
+    // flusher thread
+    std::array<FrameSample, WINDOW_SIZE> window_{};
+    std::size_t window_count_ = 0;
+    std::size_t window_next_ = 0;
+    std::size_t frames_ = 0;
+    std::vector<double> scratch_;
+    std::vector<double> latency_scratch_;
 };
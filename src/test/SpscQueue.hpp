@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer/single-consumer queue. push() and pop() never block nor allocate,
+// a full queue rejects new items instead of waiting for the consumer.
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side
+    bool push(const T& item) {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& item) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> items_{};
+    // producer and consumer indexes on separate cache lines
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
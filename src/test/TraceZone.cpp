@@ -0,0 +1,49 @@
+#include "TraceZone.hpp"
+#include "PerfmonSink.hpp"
+#include "SpscQueue.hpp"
+
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace tiley {
+
+namespace detail {
+    std::atomic<bool> zones_enabled{false};
+}
+
+// Zones of one thread: the thread produces, the flusher consumes
+struct ZoneBuffer {
+    std::uint32_t tid = 0;
+    SpscQueue<ZoneEvent, 4096> queue;
+};
+
+// Buffers outlive their threads, there are only a handful(main thread, one per output)
+static std::vector<std::unique_ptr<ZoneBuffer>> g_buffers;
+static std::mutex g_buffers_mu;
+static thread_local ZoneBuffer* t_buffer = nullptr;
+
+void detail::recordZone(const ZoneEvent& zone) noexcept {
+    if (!t_buffer) {
+        auto buffer = std::make_unique<ZoneBuffer>();
+        buffer->tid = (std::uint32_t)syscall(SYS_gettid);
+        std::lock_guard<std::mutex> lk(g_buffers_mu);
+        t_buffer = g_buffers.emplace_back(std::move(buffer)).get();
+    }
+    // A full queue loses the zone, the flusher catches up on its next round
+    t_buffer->queue.push(zone);
+}
+
+void drainTraceZones(const std::vector<std::unique_ptr<PerfmonSink>>& sinks) {
+    std::lock_guard<std::mutex> lk(g_buffers_mu);
+    ZoneEvent zone;
+    for (const auto& buffer : g_buffers) {
+        while (buffer->queue.pop(zone)) {
+            for (const auto& sink : sinks) {
+                sink->zone(buffer->tid, zone);
+            }
+        }
+    }
+}
+
+} 
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tiley {
+
+class PerfmonSink;
+
+// One timed scope. `name` is a string literal, only the pointer is recorded
+struct ZoneEvent {
+    const char* name = nullptr;
+    std::int64_t start_ns = 0;  // steady clock
+    std::int64_t end_ns = 0;
+};
+
+namespace detail {
+    extern std::atomic<bool> zones_enabled;
+    // Push into the calling thread's zone queue, never blocks
+    void recordZone(const ZoneEvent& zone) noexcept;
+}
+
+// Set by the "zones" perfmon sink, see PerfmonRegistry
+inline bool traceZonesEnabled() {
+    return detail::zones_enabled.load(std::memory_order_relaxed);
+}
+
+// RAII timer of the enclosing scope, a relaxed load and nothing else while zones are off
+class TraceZone {
+public:
+    explicit TraceZone(const char* name) noexcept
+        : name_(traceZonesEnabled() ? name : nullptr),
+          start_ns_(name_ ? now() : 0) {}
+
+    ~TraceZone() {
+        if (name_) {
+            detail::recordZone({name_, start_ns_, now()});
+        }
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+    static std::int64_t now() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    const char* name_;
+    std::int64_t start_ns_;
+};
+
+// Flusher side: hand the zones of every thread to `sinks`, caller holds the sink lock
+void drainTraceZones(const std::vector<std::unique_ptr<PerfmonSink>>& sinks);
+
+} 
+
+#define TILEY_TRACE_CONCAT_(a, b) a##b
+#define TILEY_TRACE_CONCAT(a, b) TILEY_TRACE_CONCAT_(a, b)
+// TILEY_TRACE_ZONE("Class::method"): time the rest of the current scope
+#define TILEY_TRACE_ZONE(name) ::tiley::TraceZone TILEY_TRACE_CONCAT(tileyTraceZone_, __LINE__){name}
@@ -9,13 +9,15 @@
 #include "src/lib/TileyServer.hpp"
 #include "src/lib/TileyWindowStateManager.hpp"
 #include "src/lib/ipc/IPCManager.hpp"
+#include "src/lib/input/LatencyProbe.hpp"
 #include "src/lib/client/WallpaperManager.hpp"
 #include "src/lib/types.hpp"
+#include "src/test/PerfmonRegistry.hpp"
 
 // Startup args collection
 tiley::LaunchArgs setupParams(int argc, char* argv[]){
 
-    tiley::LaunchArgs args = {false, nullptr};
+    tiley::LaunchArgs args = {false, nullptr, nullptr};
     
     int c;
 
@@ -23,10 +25,11 @@ tiley::LaunchArgs setupParams(int argc, char* argv[]){
     struct option longopts[] = {
         {"debug", no_argument, NULL, 'd'},
         {"start", required_argument, NULL, 's'},
+        {"perfmon", optional_argument, NULL, 'p'},
         {0,0,0,0}
     };
 
-    while((c = getopt_long(argc, argv, "ds:", longopts, NULL)) != -1){
+    while((c = getopt_long(argc, argv, "ds:p::", longopts, NULL)) != -1){
         switch(c){
             case 'd':
                 args.enableDebug = true;
@@ -34,6 +37,10 @@ tiley::LaunchArgs setupParams(int argc, char* argv[]){
             case 's':
                 args.startupCMD = optarg;
                 break;
+            case 'p':
+                // --perfmon[=csv,trace,ipc,zones], csv if no sink is given
+                args.perfmonSinks = optarg ? optarg : "csv";
+                break;
             default:
                 break;
         }
@@ -87,6 +94,17 @@ int main(int argc, char* argv[]){
         return EXIT_FAILURE;
     }
 
+    // Perf monitoring is off unless asked for, the command line wins over TILEY_PERFMON
+    const char* perfmonSpec = args.perfmonSinks ? args.perfmonSinks : getenv("TILEY_PERFMON");
+    if(perfmonSpec){
+        unsigned sinks;
+        if(tiley::parsePerfmonSinks(perfmonSpec, sinks)){
+            tiley::setPerfmonSinks(sinks);
+        }else{
+            LLog::warning("[main]: unknown perfmon sinks: %s, expected a list of csv, trace, ipc, zones", perfmonSpec);
+        }
+    }
+
     // Special settings for wayland backend
     if(compositor.graphicBackendId() == LGraphicBackendWayland){
         // TODO
@@ -96,6 +114,8 @@ int main(int argc, char* argv[]){
     tiley::TileyWindowStateManager::getInstance().initialize();
     // IPC Management Initialization
     tiley::IPCManager::getInstance().initialize();
+    // Synthetic input for latency measurements(TILEY_LATENCY_PROBE)
+    tiley::LatencyProbe::getInstance().initialize();
 
     //***************Launch****************
     while(compositor.state() != LCompositor::Uninitialized){
@@ -103,6 +123,7 @@ int main(int argc, char* argv[]){
     }
 
     tiley::TileyServer::getInstance().uninitOpenGLResources();
+    tiley::shutdownPerfmons();
 
     return EXIT_SUCCESS;
 